@@ -8,878 +8,593 @@
  * 2. 1 enemy/boss
  * 3. 1 weapon
  * 4. 2 hazs and 2 relocs
+ *
+ * This file is the console front end; the rules live in wump_engine.cpp.
  */
 
 #include <iostream>
+#include <cerrno>
+#include <climits>
 #include <stdlib.h>
 #include <cstring>
 #include <cmath>
 #include <fstream>
+#include <sstream>
 #include <cstdlib>
 #include <exception>
-#ifdef _WIN32
-    #include <windows.h>
-#else
-    #include <unistd.h>
-#endif
+#include <chrono>
+#include <random>
+#include <memory>
+#include "wump_engine.h"
+#include "wump_levelgen.h"
+#include "wump_assets.h"
+#include "wump_render.h"
+#include "wump_anim.h"
+#include "wump_log.h"
+#include "wump_dialog.h"
+#include "wump_metrics.h"
+#include "wump_sink.h"
+#include "wump_text.h"
 using namespace std;
 
 const bool DEBUG = false;
 const bool INTRO = true;
 
-// LevelResult passed from Level to Game
-struct LevelResult {
-    bool climbDown = false;
-    bool climbUp   = false;
-    bool wonGame   = false;
-    bool died      = false;
-    bool killedEnemy = false;
-};
-
-// Cross-platform wait
-void CPWait(int seconds) {
-    #ifdef _WIN32
-        Sleep(seconds * 1000);
-    #else
-        sleep(seconds);
-    #endif
-}
-
-// Output file that is ascii (text, ~graphics)
-void CatFile(const std::string& filename, int waitSeconds) {
-    // Clear the screen (platform specific)
-    #ifdef _WIN32
-        system("cls");
-    #else
-        system("clear");
-    #endif
-    ifstream file(filename);
-    if (file.is_open()) {
-        string line;
-        while (getline(file, line)) {
-            cout << line << endl;
-        }
-        file.close();
+AssetBundle assets;     // ascii_img.pak, opened once in main
+Screen screen;          // draws only what changed since the last image
+TurnLog turnLog;        // --record: every level played, for wump_replay
+ofstream recordFile;
+LevelGenerator* levelCheck = nullptr;   // --safe-levels, --min-enemy-distance
+
+// Output ascii (text, ~graphics) image from the asset bundle
+void CatFile(const std::string& name) {
+    const char* data;
+    size_t length;
+    if (assets.Find(name, &data, &length)) {
+        screen.Present(data, length);
     } else {
-        cout << "Error: Could not open file " << filename << endl;
-    }
-    if (waitSeconds > 0) {
-        CPWait(waitSeconds);
-    }
-}
-
-class Enemy {
-private:
-    int lev;
-public:
-    string warningMsg;
-    string killedItMsg;
-    string killedYouMsg;
-    float pMove;
-
-    Enemy(int);
-    void StartledSequence();
-    void KilledItSequence();
-    void KilledYouSequence();
-};
-
-// conx
-Enemy::Enemy(int thisLev) {
-    lev = thisLev;    
-
-    // e.g., use pMove = 1 to always move
-    if (lev == 0) {
-        // SPIDER
-        warningMsg = "You hear a light tap-tap coming towards you...";
-        killedItMsg = "SHLACHING.. Thump! \nGood shot! You killed the Spider!";
-        killedYouMsg = "The Spider bit you and quickly wrapped you in a cocoon web!"; 
-        pMove = 1;
-    } else if (lev == 1) {
-        // SNAKE
-        warningMsg = "You hear something slither on the ground...";
-        killedItMsg = "KA-POW.. Slice! \nNice! You killed the Snake!";
-        killedYouMsg = "The Snake bit you! You've been injected with venom!";
-        pMove = 1;
-    } else if (lev == 2) {
-        // FROST MAGE
-        warningMsg = "You feel a sudden chill...";
-        killedItMsg = "SS-TCCAAH.. Pow! \nVictory! You killed the Frost Mage!";
-        killedYouMsg = "The Frost Mage cast a spell that instantaneously froze you to the core!";
-        pMove = 1;
-    } else if (lev == 3) {
-        // WUMPUS
-        warningMsg = "You smell a horrid stench...";
-        killedItMsg = "ARGH.. Splat! \nCongratulations! You killed the Wumpus!";
-        killedYouMsg = "The Wumpus ate you!";
-        pMove = 0.75;
-    }
-}
-
-void Enemy::StartledSequence() {
-    if (lev == 0) {
-        // SPIDER
-        cout << "Miss! But you startled the Spider" << endl;
-    } else if (lev == 1) {
-        // SNAKE
-        cout << "Miss! But you startled the Snake" << endl;
-    } else if (lev == 2) {
-        // FROST MAGE
-        cout << "Miss! But you startled the Frost Mage" << endl;
-    } else if (lev == 3) {
-        // WUMPUS
-        cout << "Miss! But you startled the Wumpus" << endl;
-    }
-}
-
-void Enemy::KilledItSequence() {
-    if (lev == 0) {
-        // ARROW - SPIDER
-        CatFile("ascii_img/arrow", 1);
-        CatFile("ascii_img/spider.rotate", 1);
-    } else if (lev == 1) {
-        // SPADE - SNAKE
-        CatFile("ascii_img/spade", 1);
-        CatFile("ascii_img/snake.rotate", 1);
-    } else if (lev == 2) {
-        // CLUB - FROST MAGE
-        CatFile("ascii_img/club", 1);
-        CatFile("ascii_img/frost.mage", 1);
-        CatFile("ascii_img/explosion", 1);
-    } else if (lev == 3) {
-        // SWORD - WUMPUS
-        CatFile("ascii_img/sword", 1);
-        CatFile("ascii_img/wump.rotate", 1);
-    }
-    cout << killedItMsg << endl;
-}
-
-void Enemy::KilledYouSequence() {
-    if (lev == 0) {
-        // SPIDER
-        CatFile("ascii_img/spider", 1);
-    } else if (lev == 1) {
-        // SNAKE
-        CatFile("ascii_img/snake", 1);
-    } else if (lev == 2) {
-        // FROST MAGE
-        CatFile("ascii_img/frost.mage", 1);
-    } else if (lev == 3) {
-        // WUMPUS
-        CatFile("ascii_img/wump.partial", 1);
-        CatFile("ascii_img/wump.blur", 1);
-        CatFile("ascii_img/wump", 1);
-    }
-    cout << killedYouMsg << endl;
-}
-
-class Weapon {
-private:
-    int lev;
-public:
-    bool haveWeapon;
-    bool isLimited;
-    int  quantity;
-    float pToHit;
-
-    Weapon(int);
-    void HaveWeaponSequence();
-};
-
-// conx
-Weapon::Weapon(int thisLev) {
-    lev = thisLev;
-    // use 1 for always hit
-    if (lev == 0) { 
-        // BOW
-        haveWeapon = false; // effectively not until you find an arrow
-        isLimited = true;
-        quantity = 0;  // starting number of arrows
-        pToHit = 1;  
-    } else if (lev == 1) {
-        // SPADE
-        haveWeapon = false;
-        isLimited = false;
-        quantity = 0;
-        pToHit = 0.75;
-    } else if (lev == 2) { 
-        // CLUB
-        haveWeapon = false;
-        isLimited = false;
-        quantity = 0;
-        pToHit = 1;
-    } else if (lev == 3) { 
-        // SWORD
-        haveWeapon = false;
-        isLimited = false;
-        quantity = 0;
-        pToHit = 0.5;
-    }
-} 
-
-void Weapon::HaveWeaponSequence() {
-    if (!haveWeapon) {
-        if (lev == 0) {
-            // BOW
-            CatFile("ascii_img/arrow", 1);
-            CatFile("ascii_img/bow", 1);
-            cout << "You found two arrows!" << endl;
-            quantity = 2;
-        } else if (lev == 1) {
-            // SPADE
-            CatFile("ascii_img/spade", 1);
-            cout << "You found the spade!" << endl;
-        } else if (lev == 2) {
-            // CLUB
-            CatFile("ascii_img/club", 1);
-            cout << "You found the club!" << endl;
-        } else if (lev == 3) {
-            // SWORD
-            CatFile("ascii_img/sword", 1);
-            cout << "You found the sword!" << endl;
+        // no bundle: fall back to the loose file
+        ifstream file("ascii_img/" + name, ios::binary);
+        if (file.is_open()) {
+            stringstream buffer;
+            buffer << file.rdbuf();
+            string frame = buffer.str();
+            screen.Present(frame.data(), frame.size());
+            file.close();
+        } else {
+            cout << "Error: Could not open file " << name << '\n';
         }
     }
-    haveWeapon = true;
 }
 
-class Hazard {
-private:
-    int lev;
-public:
-    string nearMsg;
-
-    Hazard(int);
-    void KillSequence();
-};
-
-Hazard::Hazard(int thisLev) {
-    lev = thisLev;
-    nearMsg = "You feel a draft...";
-
-/* FUTURE
-    if (lev == 0) {
-        // PIT
-        nearMsg = "You feel a draft...";
-    } else if (lev == 1) {
-        // 
-        nearMsg = "...";
-    }
-*/
-}
+Animator animator(CatFile);     // plays CatFile images as skippable sequences
 
-void Hazard::KillSequence() {
-    CatFile("ascii_img/pit", 1);
-    cout << "@#$*! You fell in a pit!" << endl;
-
-/* FUTURE
-    if (lev == 0) {
-        // PIT
-        CatFile("ascii_img/pit", 1);
-        cout << "@#$*! You fell in a pit!" << endl;
-    } else if (lev == 1) {
-        // 
-        CatFile("", 1);
-        cout << "..." << endl;
-    }
-*/
-}
+// The *Sequence functions show the player what the engine's events mean
 
-class Relocator {
-private:
-    int lev;
-public:
-    string nearMsg;
-    string savedMsg;
-    string movedMsg;
-
-    Relocator(int);
-    void RelocateSequence();
-};
-
-Relocator::Relocator(int thisLev) {
-    lev = thisLev;
-    nearMsg = "Bats nearby...";
-    savedMsg = "Luckily, the bats saved you from a hazard!";
-    movedMsg = "The bats moved you to room ";
-
-/* FUTURE
-    if (lev == 0) {
-        // BAT
-        nearMsg = "Bats nearby...";
-        savedMsg = "Luckily, the bats saved you from a hazard!";
-        movedMsg = "The bats moved you to room ";
-    } else if (lev == 1) {
-        // 
-        nearMsg = "...";
-        savedMsg = "...!";
-        movedMsg = "";
-    }
-*/
-};
-
-void Relocator::RelocateSequence() {
-    CatFile("ascii_img/bat", 1);
-    cout << "Snatched by superbats!" << endl;
-
-/* FUTURE
-    if (lev == 0) {
-        // BAT
-        CatFile("ascii_img/bat", 1);
-        cout << "Snatched by superbats!" << endl;
-    } else if (lev == 1) {
-        // 
-        CatFile("", 1);
-        cout << "..." << endl;
-    }
-*/
+void QueueImages(const vector<string>& names) {
+    for (const string& name : names)
+        animator.Queue(name);
 }
 
-class Level {
-private:
-    int numRooms;
-    int currentRoom, startingPosition; 
-    int enemyRoom, relocRoom1, relocRoom2, hazRoom1, hazRoom2, weaponRoom; // Stores the room numbers of the respective
-    int enemyStart, reloc1Start, reloc2Start;
-    int myLevelNum;
-    LevelResult result; // climb down, up, win, die, kill enemy
-    Weapon* myWeapon;
-    Enemy*  myEnemy;
-    Hazard* myHaz;
-    Relocator* myReloc;
-
-    // constant value 2d array to represent the dodecahedron room structure
-    // rooms are thus 0 - 19
-    constexpr static int adjacentRooms[20][3] = {
-        {1, 4, 7},    {0, 2, 9},   {1, 3, 11},   {2, 4, 13},   {0, 3, 5},
-        {4, 6, 14},   {5, 7, 16},  {0, 6, 8},    {7, 9, 17},   {1, 8, 10},
-        {9, 11, 18},  {2, 10, 12}, {11, 13, 19}, {3, 12, 14},  {5, 13, 15},
-        {14, 16, 19}, {6, 15, 17}, {8, 16, 18},  {10, 17, 19}, {12, 15, 18}
-    };
-
-    void PlaceHazs();
-    void PlaceRelocs();
-    void PlaceEnemy();
-    void PlacePlayer();
-    void PlaceWeapon();
-    bool IsValidMove(int);
-    bool IsRoomAdjacent(int, int);
-    int  Move(int);
-    void InspectCurrentRoom();
-    void PerformAction(int);
-    void MoveStartledEnemy(int);
-    void PlayAgain();
-    void CurrentRoomEnemyRoom();
-
-public:
-    Level();
-    Level(int);
-    void SetLevelNum(int);
-    LevelResult PlayLevel();
-
-    ~Level() {
-        if (myEnemy != nullptr) {
-            delete myEnemy;
-            myEnemy = nullptr;
-        }
-        if (myWeapon != nullptr) {
-            delete myWeapon;
-            myWeapon = nullptr;
-        }
-        if (myHaz != nullptr) {
-            delete myHaz;
-            myHaz = nullptr;
-        }
-        if (myReloc != nullptr) {
-            delete myReloc;
-            myReloc = nullptr;
-        }
-    }
-};
-
-// conx
-Level::Level() {
+void StartledSequence(const Enemy& enemy) {
+    cout << "Miss! But you startled the " << enemy.name << '\n';
 }
 
-// conx
-Level::Level(int myLev) {
-    numRooms = 20;
-    myLevelNum = myLev;
-
-    // construct these every time / delete these every time
-    myEnemy  = new Enemy(myLevelNum);
-    myWeapon = new Weapon(myLevelNum);
-    myHaz    = new Hazard(myLevelNum);
-    myReloc  = new Relocator(myLevelNum);
+void KilledItSequence(const Weapon& weapon, const Enemy& enemy) {
+    QueueImages(weapon.attackImages);
+    QueueImages(enemy.killedItImages);
+    animator.Play();
+    cout << enemy.killedItMsg << '\n';
 }
 
-// This function will place two relocs throughout the map
-// this ensures that the relocs will not be place in the same
-// room as another reloc or the enemy
-void Level::PlaceRelocs() {
-    bool validRoom = false;
-    while (!validRoom) {
-        relocRoom1 = rand() % 19 + 1;
-        if (relocRoom1 != enemyRoom)
-            validRoom = true;
-    }
-
-    validRoom = false;
-    while (!validRoom) {
-        relocRoom2 = rand() % 19 + 1;
-        if (relocRoom2 != enemyRoom && relocRoom2 != relocRoom1)
-            validRoom = true;
-    }
-
-    reloc1Start = relocRoom1;
-    reloc2Start = relocRoom2;
-if (DEBUG) cout << "RELOC ROOM 1: " << to_string(relocRoom1) << endl;
-if (DEBUG) cout << "RELOC ROOM 2: " << to_string(relocRoom2) << endl;
+void KilledYouSequence(const Enemy& enemy) {
+    QueueImages(enemy.killedYouImages);
+    animator.Play();
+    cout << enemy.killedYouMsg << '\n';
 }
 
-// this function randomly places the hazs
-// throughout the map excluding room 0
-void Level::PlaceHazs() {
-    hazRoom1 = rand() % 19 + 1;
-    hazRoom2 = rand() % 19 + 1;
-if (DEBUG) cout << "HAZ ROOM 1: " << to_string(hazRoom1) << endl;
-if (DEBUG) cout << "HAZ ROOM 2: " << to_string(hazRoom2) << endl;
+void HaveWeaponSequence(const Weapon& weapon) {
+    QueueImages(weapon.foundImages);
+    animator.Play();
+    cout << weapon.foundMsg << '\n';
 }
 
-// this function randomly places the enemy in a room
-// without being in room number 0
-void Level::PlaceEnemy() {
-    enemyRoom = rand() % 19 + 1;
-    enemyStart = enemyRoom;
-if (DEBUG) cout << "ENEMY ROOM: " << to_string(enemyRoom) << endl;
+void KillSequence(const Hazard& hazard) {
+    QueueImages(hazard.images);
+    animator.Play();
+    cout << hazard.killedYouMsg << '\n';
 }
 
-// place the player in room 0
-void Level::PlacePlayer() {
-    startingPosition = 0;
-    currentRoom = Move(0);
+void RelocateSequence(const Relocator& reloc) {
+    QueueImages(reloc.images);
+    animator.Play();
+    cout << reloc.snatchedMsg << '\n';
 }
 
-// 
-void Level::PlaceWeapon() {
-    bool validRoom = false;
-    while (!validRoom) {
-        weaponRoom = rand() % 19 + 1; 
-        if (weaponRoom != enemyRoom && weaponRoom != hazRoom1 && weaponRoom != hazRoom2)
-            validRoom = true;
-    }
-if (DEBUG) cout << "WEAPON ROOM: " << to_string(weaponRoom) << endl;
-}
-
-// This is a  method that checks if the user inputted a valid room to move to or not.
-// The room number has to be between 0 and 19, but also must be adjacent to the current room.
-bool Level::IsValidMove(int roomID) {
-    if ((roomID < 0) || \
-        (roomID > numRooms-1) || \
-        (!IsRoomAdjacent(currentRoom, roomID))) {
-        return false;
+// Show the events of one Start()/Step() of the level
+void ShowEvents(const Level& level, const StepResult& step) {
+    for (int i = 0; i < step.numEvents; i++) {
+        const Event& event = step.events[i];
+        switch (event.type) {
+            case EventType::EnteredRoom:
+                cout << "You are in room ";
+                cout << event.room << '\n';
+                if (event.value & WARN_ENEMY) {
+                    cout << level.GetEnemy().warningMsg << '\n';
+                }
+                if (event.value & WARN_BATS) {
+                    cout << level.GetReloc().nearMsg << '\n';
+                }
+                if (event.value & WARN_DRAFT) {
+                    cout << level.GetHazard().nearMsg << '\n';
+                }
+                cout << "Tunnels lead to rooms " << '\n';
+                for (int j = 0; j < level.NumNeighbors(event.room); j++)
+                {
+                    cout << level.Neighbors(event.room)[j];
+                    cout << " ";
+                }
+                cout << '\n';
+                break;
+            case EventType::FoundWeapon:
+                HaveWeaponSequence(level.GetWeapon());
+                break;
+            case EventType::BatSnatched:
+                RelocateSequence(level.GetReloc());
+                break;
+            case EventType::BatSaved:
+                cout << level.GetReloc().savedMsg << '\n';
+                break;
+            case EventType::BatDropped:
+                RelocateSequence(level.GetReloc());
+                cout << level.GetReloc().movedMsg << '\n';
+                cout << event.room << '\n';
+                break;
+            case EventType::FellInPit:
+                KillSequence(level.GetHazard());
+                break;
+            case EventType::KilledEnemy:
+                KilledItSequence(level.GetWeapon(), level.GetEnemy());
+                break;
+            case EventType::KilledByEnemy:
+                KilledYouSequence(level.GetEnemy());
+                break;
+            case EventType::LevelRestarted:
+                cout << "Try not to die this time. \n" << '\n';
+                break;
+            case EventType::InvalidMove:
+                cout << "You cannot move there." << '\n';
+                break;
+            case EventType::InvalidAttack:
+                cout << "You cannot attack there." << '\n';
+                break;
+            case EventType::CannotAttack:
+                cout << "You cannot attack - no or limited weapon, or out of ammo." << '\n';
+                break;
+            case EventType::EnemyStartled:
+                StartledSequence(level.GetEnemy());
+                break;
+            case EventType::EnemyMoved:
+                cout << "And the enemy moved!" << '\n';
+if (DEBUG) cout << "MOVED ENEMY TO ROOM " << to_string(event.room) << '\n';
+                break;
+            case EventType::AmmoLeft:
+                cout << "Ammunition Left: ";
+                cout << event.value << '\n';
+                break;
+            case EventType::QuitLevel:
+                break;
+        }
     }
-    return true;
 }
 
-// This method returns true if roomB is adjacent to roomA, otherwise returns false.
-// It is a helper method that loops through the adjacentRooms array to check.
-// It will be used throughout the app to check if we are next to the enemy, relocs, or hazs
-// as well as check if we can make a valid move.
-bool Level::IsRoomAdjacent(int roomA, int roomB)
+// Start the level, on a layout that passes the level rules if any are set
+StepResult StartLevel(Level& level)
 {
-    for (int j = 0; j < 3; j++) {
-        if (adjacentRooms[roomA][j] == roomB) {
-          return true;
-        }
-    }
-    return false;
+    if (levelCheck)
+        levelCheck->Prepare(level);
+    StepResult step = level.Start();
+    if (recordFile.is_open())
+        turnLog.BeginLevel(level, step);
+    return step;
 }
 
-// This method moves the player to a new room and returns the new room. 
-int Level::Move(int newRoom)
+// Step the level, logging the turn when recording
+StepResult TakeTurn(Level& level, const Action& action)
 {
-    // currently performs no checks on its own
-    return newRoom;
+    MetricsTimer timer(Timing::Turn);
+    StepResult step = level.Step(action);
+    if (recordFile.is_open())
+        turnLog.Step(action, step);
+    return step;
 }
 
-// Inspects the current room.
-// This method check for Hazards such as being in the same room as the enemy, relocs, or hazs
-// It also checks if you are adjacent to a hazard and handle those cases
-// Finally it will just print out the room description
-void Level::InspectCurrentRoom() {
-    CurrentRoomEnemyRoom();
-    if (result.killedEnemy || result.died)
-        return;
-    
-    if (currentRoom == weaponRoom) {     // can find weapon then be picked up by relocs, in that order
-        myWeapon->HaveWeaponSequence();
-    } 
-    if (currentRoom == relocRoom1 || currentRoom == relocRoom2) {
-        int roomRelocsLeft = currentRoom;
-        bool validNewRelocRoom = false;
-        bool isRelocRoom = false;
-
-        myReloc->RelocateSequence();
-        if (currentRoom == hazRoom1 || currentRoom == hazRoom2)
-            cout << myReloc->savedMsg << endl;
-        while (!isRelocRoom) {
-            currentRoom = Move(rand() % 19 + 1);
-            if (currentRoom != relocRoom1 && currentRoom != relocRoom2)
-                isRelocRoom = true;
-        }
-        myReloc->RelocateSequence();
-        cout << myReloc->movedMsg << endl;
-        cout << currentRoom << endl;
-
-        InspectCurrentRoom();
-
-        if (roomRelocsLeft == relocRoom1) {
-            while (!validNewRelocRoom) {
-                relocRoom1 = rand() % 19 + 1;
-                if (relocRoom1 != enemyRoom && relocRoom1 != currentRoom)
-                    validNewRelocRoom = true;
-            }
-        } else {
-            while (!validNewRelocRoom) {
-                relocRoom2 = rand() % 19 + 1;
-                if (relocRoom2 != enemyRoom && relocRoom2 != currentRoom)
-                    validNewRelocRoom = true;
-            }
-        }
-    } else if (currentRoom == hazRoom1 || currentRoom == hazRoom2) {
-        myHaz->KillSequence();
-        PlayAgain();
-    } else {
-        cout << "You are in room ";
-        cout << currentRoom << endl;
-        if (IsRoomAdjacent(currentRoom, enemyRoom)) {
-            cout << myEnemy->warningMsg << endl;
-        }
-        if (IsRoomAdjacent(currentRoom, relocRoom1) || IsRoomAdjacent(currentRoom, relocRoom2)) {
-            cout << myReloc->nearMsg << endl;
-        }
-        if (IsRoomAdjacent(currentRoom, hazRoom1) || IsRoomAdjacent(currentRoom, hazRoom2)) {
-            cout << myHaz->nearMsg << endl;
-        }
-        cout << "Tunnels lead to rooms " << endl;
-        for (int j = 0; j < 3; j++)
-        {
-            cout << adjacentRooms[currentRoom][j];
-            cout << " ";
-        }
-        cout << endl;
+// Write the level's record out when recording
+void EndLevelLog(const Level& level)
+{
+    if (recordFile.is_open()) {
+        turnLog.EndLevel(level.Result());
+        recordFile.write(turnLog.Data().data(), turnLog.Data().size());
+        recordFile.flush();
+        turnLog.Clear();
     }
 }
 
-// PerformAction
-void Level::PerformAction(int cmd) {
-    int newRoom;
-    switch (cmd) {
-        case 1:     // move
-            cout << "Which room? " << endl;
-            try {
-                cin >> newRoom;
-                // Check if the user input a valid room id, then simply tell the player to move there.
-                if (IsValidMove(newRoom)) {
-                    currentRoom = Move(newRoom);
-                    InspectCurrentRoom();
-                } else {
-                    cout << "You cannot move there." << endl;
-                }
-            }
-            catch (...) { // Try...Catch block will catch if the user inputs text instead of a number.
-                cout << "You cannot move there." << endl;
-            }
-            break;
-        case 2:     // attack
-            if (myWeapon->haveWeapon && (!myWeapon->isLimited || (myWeapon->isLimited && myWeapon->quantity > 0))) {
-                cout << "Which room? " << endl;
-                try {
-                    cin >> newRoom;
-                    // Check if the user input a valid room id, then attack into that room.
-                    if (IsValidMove(newRoom)) {
-                        myWeapon->quantity--;
-                        if (newRoom == enemyRoom) {
-                            myEnemy->KilledItSequence();
-                            cout << "Press 0 to return to the game menu." << endl;
-                            result.killedEnemy = true;
-                            cin >> newRoom;
-                            cin.clear(); cin.ignore(10000, '\n');
-                        } else {
-                            MoveStartledEnemy(enemyRoom);
-                            if (myWeapon->isLimited) {
-                                cout << "Ammunition Left: ";
-                                cout << myWeapon->quantity << endl;
-                            }
-                            CurrentRoomEnemyRoom();
-                        }
-                    } 
-                }
-                catch (...) { // Try...Catch block will catch if the user inputs text instead of a number.
-                    cout << "You cannot attack there." << endl;
-                }
-            } else {
-                    cout << "You cannot attack - no or limited weapon, or out of ammo." << endl;
-            }
-            break;
-        case 3:     // quit
-            cout << "Quiting level." << endl;
-            break;
-        default:
-            cout << "You cannot do that. You can move, attack or quit." << endl;
-            break;
-    }
+// the number in a word of input, or -1 (never a valid choice or room);
+// any room of any cave fits, and the level rejects rooms it does not have
+int Number(const string& word) {
+    char* end;
+    errno = 0;
+    long value = strtol(word.c_str(), &end, 10);
+    if (end == word.c_str() || *end != '\0' || errno == ERANGE || value < 0 || value > INT_MAX)
+        return -1;
+    return int(value);
 }
 
-// this function moves the enemy randomly to a room that is adjacent to
-// the enemy's current position
-void Level::MoveStartledEnemy(int roomNum) {
-if (DEBUG) cout << "STARTLED ENEMY IN ROOM " << to_string(roomNum) << endl;
-    myEnemy->StartledSequence();
-    if ((rand() % 100) < int(round(myEnemy->pMove * 100))) {    // move if (0-99) turns out less than prob * 100
-        int rando = rand() % 3;
-        enemyRoom = adjacentRooms[roomNum][rando];
-        cout << "And the enemy moved!" << endl;
-if (DEBUG) cout << "MOVED ENEMY TO ROOM " << to_string(enemyRoom) << endl;
-    }
+// PlayLevel() plays one level on the console.
+// It houses the level loop and when PlayLevel() finishes the level has ended.
+// Every read from the player is a co_await, so it never blocks a thread.
+Dialog PlayLevel(Level& level)
+{
+    cout << "Loading level " << to_string(level.LevelNum()) << " ..." << '\n';
+
+    int choice, newRoom;
+    StepResult step = StartLevel(level);
+if (DEBUG) {
+    const LevelLayout& layout = level.Layout();
+    for (size_t i = 0; i < layout.enemyRooms.size(); i++)
+        cout << "ENEMY ROOM " << to_string(i + 1) << ": " << to_string(layout.enemyRooms[i]) << '\n';
+    for (size_t i = 0; i < layout.relocRooms.size(); i++)
+        cout << "RELOC ROOM " << to_string(i + 1) << ": " << to_string(layout.relocRooms[i]) << '\n';
+    for (size_t i = 0; i < layout.hazRooms.size(); i++)
+        cout << "HAZ ROOM " << to_string(i + 1) << ": " << to_string(layout.hazRooms[i]) << '\n';
+    for (size_t i = 0; i < layout.weaponRooms.size(); i++)
+        cout << "WEAPON ROOM " << to_string(i + 1) << ": " << to_string(layout.weaponRooms[i]) << '\n';
 }
+    ShowEvents(level, step);
 
-// When in the same room with the enemy:
-// If have the weapon and hit, it dies. 
-// If don't have the weapon or have it and miss, you die.
-void Level::CurrentRoomEnemyRoom() {
-    if (currentRoom == enemyRoom)
-    {
-        if (myWeapon->haveWeapon && (!myWeapon->isLimited || (myWeapon->isLimited && myWeapon->quantity > 0))) {
-            // do attack if (0-99) turns out less than prob * 100
-            if ((rand() % 100) < int(round(myWeapon->pToHit * 100))) { 
-                myEnemy->KilledItSequence();
-                result.killedEnemy = true;
-            } else {
-                myEnemy->KilledYouSequence();
-                PlayAgain();
-            }
-        } else { // no weapon/no ammo
-            myEnemy->KilledYouSequence();
-            PlayAgain();
+    // level loop
+    while (level.Phase() != LevelPhase::Over) { // while you & enemy are alive
+        if (level.Phase() == LevelPhase::AwaitingReplay) {
+            cout << "Would you like to replay the same level? Enter 0 to play again." << '\n';
+            int reply = Number(co_await Dialog::Input());
+            step = TakeTurn(level, {reply == 0 ? ActionType::Replay : ActionType::Quit, -1});
+            ShowEvents(level, step);
+            continue;
         }
-    }
-}
 
-// This restarts the level from the beginning
-void Level::PlayAgain() {
-    int reply;
-    cout << "Would you like to replay the same level? Enter 0 to play again." << endl;
-    cin >> reply;
-    if (reply == 0) {
-        myWeapon->quantity = 0; // lose all ammo
-        myWeapon->haveWeapon = false;
-        currentRoom = startingPosition;
-        enemyRoom = enemyStart;
-        relocRoom1 = reloc1Start;
-        relocRoom2 = reloc2Start;
-        cout << "Try not to die this time. \n" << endl;
-        InspectCurrentRoom();
-    } else {
-        result.died = true;
-    }
-}
-
-// PlayLevel() method starts the level.
-// It houses the level loop and when PlayLevel() quits the level has ended.
-LevelResult Level::PlayLevel()
-{
-    cout << "Loading level " << to_string(myLevelNum) << " ..." << endl;
-
-    // Initialize the level
-    int choice;
-    enemyStart = reloc1Start = reloc2Start = -1;
-    PlaceEnemy();
-    PlaceRelocs();
-    PlaceHazs();
-    PlacePlayer();
-    PlaceWeapon();
-
-    result.climbDown = false;
-    result.climbUp   = false;
-    result.wonGame   = false;
-    result.died      = false;
-    result.killedEnemy = false;
-
-    // Inspects the initial room
-    InspectCurrentRoom();
-
-    // level loop
-    while ((!result.died && !result.killedEnemy)) { // while you & wump are alive
-        cout << "Enter an action choice." << endl;
-        cout << "1) Move" << endl;
-        cout << "2) Attack" << endl;
-        cout << "3) Quit" << endl;
+        cout << "Enter an action choice." << '\n';
+        cout << "1) Move" << '\n';
+        cout << "2) Attack" << '\n';
+        cout << "3) Quit" << '\n';
         cout << ">>> ";
         cout << "Please make a selection: ";
-        try {
-            cin >> choice;
-            switch (choice) {
-                case 1: 
-                case 2:
-                    PerformAction(choice);
-                    break;
-                case 3:
-                    result.died = true; // quit really
-                    break;
-                default:
-                    cout << "Invalid choice. Please try again." << endl;
-                    cin.clear(); cin.ignore(10000, '\n');
+        choice = Number(co_await Dialog::Input());
+        switch (choice) {
+            case 1:     // move
+                cout << "Which room? " << '\n';
+                newRoom = Number(co_await Dialog::Input());
+                step = TakeTurn(level, {ActionType::Move, newRoom});
+                ShowEvents(level, step);
+                break;
+            case 2:     // attack
+                if (!level.CanAttack()) {
+                    step = TakeTurn(level, {ActionType::Attack, -1});
+                    ShowEvents(level, step);
                     break;
-            }
-        }
-        catch (...) {
-            cout << "Invalid choice. Please try again." << endl;
-            cin.clear(); cin.ignore(10000, '\n');
+                }
+                cout << "Which room? " << '\n';
+                newRoom = Number(co_await Dialog::Input());
+                step = TakeTurn(level, {ActionType::Attack, newRoom});
+                ShowEvents(level, step);
+                if (step.state.result.killedEnemy) {
+                    cout << "Press 0 to return to the game menu." << '\n';
+                    co_await Dialog::Input();
+                }
+                break;
+            case 3:
+                step = TakeTurn(level, {ActionType::Quit, -1}); // quit really
+                ShowEvents(level, step);
+                break;
+            default:
+                cout << "Invalid choice. Please try again." << '\n';
+                break;
         }
-    } // while(!result.died && !result.killedEnemy)
-    return result;
-}
-
-class Game {
-private:
-    Level* levelsArray;
-    int numLevels;
-    int currentLev;
-
-public:
-    Game(int);
-    ~Game();
-    void PrintInstructions();
-    void StartGame();
-};
-
-// conx
-Game::Game(int numLevs) {
-    numLevels = numLevs;
-    levelsArray = new Level[numLevels];
-
-    for (int i=0; i<numLevels; i++) {
-        //levelsArray[i].SetLevelNum(i);
-        new (&levelsArray[i]) Level(i);
-    }
-    currentLev = 0;
+    } // while (level.Phase() != LevelPhase::Over)
+    EndLevelLog(level);
 }
 
-Game::~Game() {
-    if (levelsArray != nullptr) {
-        delete[] levelsArray;
-        levelsArray = nullptr;
-    }
-}
-
-void Game::PrintInstructions() {
-    char wait;
-    CatFile("ascii_img/instructions", 0);
-    cin >> wait;
+Dialog PrintInstructions() {
+    CatFile("instructions");
+    co_await Dialog::Input();
 }
 
 // game loop
-void Game::StartGame() {
+Dialog StartGame(Game& game) {
     int choice;
     bool keepPlaying = true;
     bool won = false;
 
-    cout << "Welcome to Wump.2" << endl;
+    cout << "Welcome to Wump.2" << '\n';
     while (keepPlaying and !won) {
         LevelResult returnedResult;
+        int currentLev = game.CurrentLevelNum();
 
-        cout << "1> Play Game Level " << to_string(currentLev) << endl;
-        cout << "2> Print Instructions" << endl;
-        cout << "3> Quit Game" << endl;
+        cout << "1> Play Game Level " << to_string(currentLev) << '\n';
+        cout << "2> Print Instructions" << '\n';
+        cout << "3> Quit Game" << '\n';
         cout << "Please make a selection> ";
-        try {
-            cin >> choice;
-            switch (choice) {
-                case 1:
-                    cout << "Playing level " << currentLev << endl;
-                    returnedResult = levelsArray[currentLev].PlayLevel();
-                    if (returnedResult.climbDown) { // not currently used
-                        cout << "climbDown......" << endl;
-                        currentLev++;
-                    }
-                    else if (returnedResult.climbUp) { // not currently used
-                        cout << "climbUp......" << endl;
-                        currentLev--;
-                    }
-                    /*else if (returnedResult.wonGame) {    // not currently used
-                        cout << "wonGame......" << endl;
-                    }
-                    */
-                    else if (returnedResult.died) { // died or quit
-                        cout << "Exiting the current level." << endl;
-                    }
-                    else if (returnedResult.killedEnemy) {
-                        cout << "You beat the level and advanced to the next one!" << endl;
-                        currentLev++;
-                        if (currentLev == numLevels) won = true;    // i.e., advanced beyond the last level
-                    }
-                    break;
-                case 2:
-                    PrintInstructions();
-                    break;
-                case 3:
-                    cout << "Quitting game." << endl;
-                    keepPlaying = false;
-                    break;
-                case 4:
-                    cout << "SELECT LEVEL" << endl;
-                    cin >> currentLev;
-                    break;
-                default:
-                    cout << "Invalid choice. Please try again." << endl;
-                    cin.clear(); cin.ignore(10000, '\n');
-                    break;
-            }
-        }
-        catch (...) {
-            cout << "Invalid choice. Please try again." << endl;
-            cin.clear(); cin.ignore(10000, '\n');
+        choice = Number(co_await Dialog::Input());
+        switch (choice) {
+            case 1:
+                cout << "Playing level " << currentLev << '\n';
+                co_await PlayLevel(game.CurrentLevel());
+                returnedResult = game.CurrentLevel().Result();
+                won = game.RecordResult(returnedResult);    // i.e., advanced beyond the last level
+                if (returnedResult.climbDown) { // not currently used
+                    cout << "climbDown......" << '\n';
+                }
+                else if (returnedResult.climbUp) { // not currently used
+                    cout << "climbUp......" << '\n';
+                }
+                /*else if (returnedResult.wonGame) {    // not currently used
+                    cout << "wonGame......" << '\n';
+                }
+                */
+                else if (returnedResult.died) { // died or quit
+                    cout << "Exiting the current level." << '\n';
+                }
+                else if (returnedResult.killedEnemy) {
+                    cout << "You beat the level and advanced to the next one!" << '\n';
+                }
+                break;
+            case 2:
+                co_await PrintInstructions();
+                break;
+            case 3:
+                cout << "Quitting game." << '\n';
+                keepPlaying = false;
+                break;
+            case 4:
+                cout << "SELECT LEVEL" << '\n';
+                currentLev = Number(co_await Dialog::Input());
+                if (currentLev >= 0 && currentLev < game.NumLevels())
+                    game.SelectLevel(currentLev);
+                break;
+            default:
+                cout << "Invalid choice. Please try again." << '\n';
+                break;
         }
     } // while (keepPlaying and !won)
 
     if (won) {
-        CatFile("ascii_img/gold", 1);
-        cout << "You won the game!" << endl;
+        animator.Queue("gold");
+        animator.Play();
+        cout << "You won the game!" << '\n';
+    }
+}
+
+// --batch: plays the commands of a file or pipe, one per line ("move 4",
+// "attack 7", see wump_text.h), as fast as the engine goes: no images and
+// no waits. The turns go to sink, which is flushed whenever the next line
+// has not arrived yet, then a report goes to stdout. Blank lines and lines
+// starting with # are skipped, and so is anything after the game ends.
+void RunBatch(Game& game, istream& in, OutputSink& sink, uint64_t seed)
+{
+    long lines = 0, commands = 0, invalid = 0, ignored = 0, turns = 0, deaths = 0, cleared = 0;
+    bool over = false, won = false;
+    string line;
+    string_view word, arg;
+    auto begin = chrono::steady_clock::now();
+
+    Level* level = &game.CurrentLevel();
+    auto startLevel = [&]() {
+        sink.Text("Loading level " + to_string(level->LevelNum()) + " ...\n");
+        StepResult step = StartLevel(*level);
+        sink.Events(*level, step);
+    };
+    startLevel();
+    for (;;) {
+        if (in.rdbuf()->in_avail() <= 0)
+            sink.Flush();       // the next command may be waiting on this reply
+        if (!getline(in, line))
+            break;
+        lines++;
+        SplitCommand(line, word, arg);
+        if (word.empty() || word[0] == '#')
+            continue;
+        if (over || won) {
+            ignored++;
+            continue;
+        }
+        commands++;
+        Action action;
+        if (!ParseCommand(*level, word, arg, action)) {
+            invalid++;
+            sink.Text("Invalid choice. Please try again.\n");
+            continue;
+        }
+        StepResult step = TakeTurn(*level, action);
+        turns++;
+        sink.Events(*level, step);
+        if (step.state.phase == LevelPhase::AwaitingReplay) {
+            deaths++;
+        } else if (step.state.phase == LevelPhase::Over) {
+            EndLevelLog(*level);
+            const LevelResult& result = level->Result();
+            if (result.killedEnemy)
+                cleared++;
+            won = game.RecordResult(result);
+            if (won) {
+                sink.Text("You won the game!\n");
+            } else if (!result.killedEnemy) {
+                sink.Text("Quitting game.\n");
+                over = true;
+            } else {
+                sink.Text("You beat the level and advanced to the next one!\n");
+                level = &game.CurrentLevel();
+                startLevel();
+            }
+        }
     }
+    sink.Flush();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    cout << "batch: seed " << seed << "\n";
+    cout << "batch: lines " << lines << ", commands " << commands
+         << ", invalid " << invalid << ", ignored " << ignored << "\n";
+    cout << "batch: turns " << turns << ", deaths " << deaths
+         << ", levels cleared " << cleared << ", level " << game.CurrentLevelNum() << "\n";
+    cout << "batch: " << (won ? "won" : over ? "quit" : "unfinished") << '\n';
+    cerr << "batch: " << commands << " commands in " << secs << " s" << endl;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // cout keeps its own buffer instead of stdio's line buffering: a turn's
+    // text goes out in one write, when cin (tied to cout) waits for input
+    // or before the next image is drawn
+    ios::sync_with_stdio(false);
 //    try {
-        srand (time(NULL));     // only necessary to do this once
+        // turbo: no waits between images, e.g. for automated runs
+        bool turbo = getenv("WUMP_TURBO") != nullptr;
+        CaveSpec caveSpec;      // the classic dodecahedron unless --cave
+        const char* levelsPath = nullptr;   // the built-in levels unless --levels
+        const char* metricsPath = nullptr;  // --metrics: counters and timings, on exit and SIGUSR1
+        const char* batchPath = nullptr;    // --batch: commands from a file, or - for stdin
+        string batchOutput = "text";        // --output text|events|none, what --batch prints per turn
+        LevelRules rules;                   // --safe-levels, --min-enemy-distance D
+        bool checkLevels = false;
+        uint64_t seed = uint64_t(chrono::system_clock::now().time_since_epoch().count()) ^ random_device{}();
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "--turbo") == 0) {
+                turbo = true;
+            } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+                seed = strtoull(argv[++i], nullptr, 10);    // replay a reported game
+            } else if (strcmp(argv[i], "--cave") == 0 && i + 1 < argc) {
+                if (!ParseCaveSpec(argv[++i], &caveSpec)) {
+                    cerr << "Unknown cave " << argv[i] << endl;
+                    return 2;
+                }
+            } else if (strcmp(argv[i], "--levels") == 0 && i + 1 < argc) {
+                levelsPath = argv[++i];
+            } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+                batchPath = argv[++i];
+            } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+                batchOutput = argv[++i];
+                if (batchOutput != "text" && batchOutput != "events" && batchOutput != "none") {
+                    cerr << "Unknown output " << batchOutput << endl;
+                    return 2;
+                }
+            } else if (strcmp(argv[i], "--safe-levels") == 0) {
+                rules.safeWeapon = true;
+                checkLevels = true;
+            } else if (strcmp(argv[i], "--min-enemy-distance") == 0 && i + 1 < argc) {
+                rules.minEnemyDistance = atoi(argv[++i]);
+                checkLevels = true;
+            } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+                metricsPath = argv[++i];
+                Metrics::EnableTiming();
+                Metrics::DumpOnSignal(metricsPath);
+            } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+                recordFile.open(argv[++i], ios::binary | ios::trunc);     // for wump_replay
+                if (!recordFile) {
+                    cerr << "Cannot write " << argv[i] << endl;
+                    return 2;
+                }
+            }
+        }
+
+        Cave cave = Cave::Dodecahedron();
+        LevelTable loaded;
+        const LevelTable* levels = &LevelTable::Default();
+        unique_ptr<LevelGenerator> generator;
+        try {
+            cave = Cave::Build(caveSpec);
+            if (levelsPath) {
+                loaded = LevelTable::Load(levelsPath);
+                levels = &loaded;
+            }
+            Game probe(cave, *levels);  // throws if the cave cannot hold some level
+            if (checkLevels) {
+                generator = make_unique<LevelGenerator>(cave, rules);
+                for (int lev = 0; lev < levels->NumLevels(); lev++) {
+                    Level check(lev, cave, *levels);
+                    generator->Prepare(check);  // throws if the level never passes
+                }
+                levelCheck = generator.get();
+            }
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 2;
+        }
+
+        // create game object, one level per level definition
+        Game game(cave, *levels);
+        game.Seed(seed);
+        if (batchPath) {
+            ifstream file;
+            if (strcmp(batchPath, "-") != 0) {
+                file.open(batchPath);
+                if (!file) {
+                    cerr << "Cannot read " << batchPath << endl;
+                    return 2;
+                }
+            }
+            // events: one line each, "event LEVEL NAME ROOM VALUE"
+            TextSink text(cout);
+            EventSink events([](const Level& level, const Event& event) {
+                cout << "event " << level.LevelNum() << ' ' << EventName(event.type) << ' '
+                     << event.room << ' ' << event.value << '\n';
+            }, []() { cout.flush(); });
+            NullSink none;
+            OutputSink& sink = batchOutput == "events" ? (OutputSink&)events
+                             : batchOutput == "none" ? (OutputSink&)none : (OutputSink&)text;
+            RunBatch(game, file.is_open() ? (istream&)file : cin, sink, seed);
+            if (metricsPath && !Metrics::Dump(metricsPath))
+                cerr << "Cannot write " << metricsPath << endl;
+            return 0;
+        }
+
+        animator.SetTurbo(turbo);
+        screen.TrackOutput(cout);
+        if (!assets.OpenDefault()) {
+            cerr << "Warning: " << WUMP_PAK_FILE << " not found, reading ascii_img/ instead" << endl;
+        }
 
         if (INTRO) {
-            CatFile("ascii_img/title", 1);
-            CatFile("ascii_img/bow", 1);
-            CatFile("ascii_img/arrow", 1);
-            CatFile("ascii_img/spade", 1);
-            CatFile("ascii_img/club", 1);
-            CatFile("ascii_img/sword", 1);
-            CatFile("ascii_img/map", 1);
-            CatFile("ascii_img/levels", 1);
-            CatFile("ascii_img/passage", 1);
-            CatFile("ascii_img/bat", 1);
-            CatFile("ascii_img/pit", 1);
-            CatFile("ascii_img/spider", 1);
-            CatFile("ascii_img/snake", 1);
-            CatFile("ascii_img/frost.mage", 1);
-            CatFile("ascii_img/wump.partial", 1);
-            CatFile("ascii_img/wump.blur", 1);
-            CatFile("ascii_img/wump", 1);
-            CatFile("ascii_img/gold", 1);
-            CatFile("ascii_img/title", 1);
-            CatFile("ascii_img/bump.word", 1);
-            CatFile("ascii_img/the.word", 1);
-            CatFile("ascii_img/wump.word", 1);
+            animator.Queue("title");
+            animator.Queue("bow");
+            animator.Queue("arrow");
+            animator.Queue("spade");
+            animator.Queue("club");
+            animator.Queue("sword");
+            animator.Queue("map");
+            animator.Queue("levels");
+            animator.Queue("passage");
+            animator.Queue("bat");
+            animator.Queue("pit");
+            animator.Queue("spider");
+            animator.Queue("snake");
+            animator.Queue("frost.mage");
+            animator.Queue("wump.partial");
+            animator.Queue("wump.blur");
+            animator.Queue("wump");
+            animator.Queue("gold");
+            animator.Queue("title");
+            animator.Queue("bump.word");
+            animator.Queue("the.word");
+            animator.Queue("wump.word");
+            animator.Play();    // Enter skips the rest
         }
 
-        // create game object, pass number of levels
-        Game game(4);
-        game.StartGame();
+        // the game waits for input with co_await; feed it one word at a time
+        Dialog dialog = StartGame(game);
+        dialog.Start();
+        string word;
+        while (!dialog.Done() && cin >> word)
+            dialog.Resume(word);
+        if (metricsPath && !Metrics::Dump(metricsPath))
+            cerr << "Cannot write " << metricsPath << endl;
 //    }
 //    catch (const exception& e) {
 //        cerr << "Exception caught: " << e.what() << endl;
@@ -0,0 +1,570 @@
+/*
+ * Wump.2 - agents, see wump_agents.h
+ */
+
+#include "wump_agents.h"
+#include <algorithm>
+#include <limits>
+using namespace std;
+
+const double SAFE = 1e-9;       // chances below this count as none
+
+// warnings of the last room described in the step, or -1 if none was
+static int LastWarnings(const StepResult& step) {
+    int warnings = -1;
+    for (int i = 0; i < step.numEvents; i++) {
+        if (step.events[i].type == EventType::EnteredRoom)
+            warnings = step.events[i].value;
+    }
+    return warnings;
+}
+
+// conx
+RandomAgent::RandomAgent(int replays) {
+    maxReplays = replays;
+    replaysLeft = replays;
+    warnings = 0;
+}
+
+void RandomAgent::BeginLevel(const Level&, const StepResult& step) {
+    replaysLeft = maxReplays;
+    warnings = 0;
+    int seen = LastWarnings(step);
+    if (seen >= 0)
+        warnings = seen;
+}
+
+Action RandomAgent::Act(const Level& level, const StepResult& last) {
+    int seen = LastWarnings(last);
+    if (seen >= 0)
+        warnings = seen;
+
+    if (last.state.phase == LevelPhase::AwaitingReplay) {
+        if (replaysLeft > 0) {
+            replaysLeft--;
+            return {ActionType::Replay, -1};
+        }
+        return {ActionType::Quit, -1};
+    }
+
+    int room = last.state.room;
+    int pick = level.Neighbors(room)[rng(level.NumNeighbors(room))];
+    if ((warnings & WARN_ENEMY) && level.CanAttack())
+        return {ActionType::Attack, pick};
+    return {ActionType::Move, pick};
+}
+
+// conx
+BeliefAgent::BeliefAgent(int replays) {
+    maxReplays = replays;
+    replaysLeft = replays;
+    cave = nullptr;
+    numRooms = 0;
+    numWeapons = 0;
+    enemyStart = -1;
+    enemyMoved = false;
+    warnings = 0;
+    attackRoom = -1;
+    numPitClues = numBatClues = 0;
+    pitRadius = batRadius = enemyRadius = 1;
+    nearStamp = 0;
+    enemyMoves = EnemyMove::Random;
+    numPits = numBats = numEnemies = enemiesLeft = 0;
+}
+
+// Sizes everything for the level's cave; only does work when it changes
+void BeliefAgent::SetCave(const Level& level) {
+    if (cave != &level.GetCave() || numRooms != level.NumRooms()) {
+        cave = &level.GetCave();
+        numRooms = level.NumRooms();
+        pitClues.clear();
+        batClues.clear();
+        for (RoomSet* set : {&deck, &visited, &maybePit, &maybeBats, &maybeEnemy,
+                             &pitClueRooms, &batClueRooms, &scratch})
+            set->Resize(numRooms);
+        pPit.assign(numRooms, 0);
+        pBats.assign(numRooms, 0);
+        pEnemy.assign(numRooms, 0);
+        risk.assign(numRooms, 0);
+        score.assign(numRooms, 0);
+        parent.assign(numRooms, -1);
+        queue.reserve(numRooms);
+        nearMark.assign(numRooms, 0);
+        nearStamp = 0;
+        clueSlot.assign(numRooms, -1);
+    }
+    pitRadius = level.GetHazard().warnRadius;
+    batRadius = level.GetReloc().warnRadius;
+    enemyRadius = level.GetEnemy().warnRadius;
+    enemyMoves = level.GetEnemy().moves;
+    numPits = level.GetDef().numHazards;
+    numBats = level.GetDef().numRelocs;
+    numEnemies = level.GetDef().numEnemies;
+    numWeapons = level.GetDef().numWeapons;
+
+    // the deck: rooms at least MinStartDistance() tunnels from room 0
+    fill(parent.begin(), parent.end(), -1);
+    queue.clear();
+    queue.push_back(0);
+    parent[0] = 0;
+    deck.Fill();
+    for (size_t i = 0; i < queue.size(); i++) {
+        int room = queue[i];
+        int distance = parent[room];    // parent doubles as the distance here
+        if (distance >= level.MinStartDistance())
+            continue;
+        deck.Reset(room);
+        for (int j = 0; j < cave->Degree(room); j++) {
+            int next = cave->Neighbors(room)[j];
+            if (parent[next] < 0) {
+                parent[next] = distance + 1;
+                queue.push_back(next);
+            }
+        }
+    }
+}
+
+// near = the rooms 1 to radius tunnels from room, walked breadth first
+// over just those rooms; nearMark is stamped rather than cleared
+void BeliefAgent::Near(int room, int radius) {
+    if (++nearStamp == numeric_limits<int>::max()) {
+        fill(nearMark.begin(), nearMark.end(), 0);
+        nearStamp = 1;
+    }
+    near.clear();
+    nearMark[room] = nearStamp;
+    auto expand = [&](int from) {
+        for (int j = 0; j < cave->Degree(from); j++) {
+            int next = cave->Neighbors(from)[j];
+            if (nearMark[next] != nearStamp) {
+                nearMark[next] = nearStamp;
+                near.push_back(next);
+            }
+        }
+    };
+    expand(room);
+    // near[ring, end) are the rooms d tunnels away
+    size_t ring = 0;
+    for (int d = 1; d < radius && ring < near.size(); d++) {
+        size_t end = near.size();
+        for (size_t i = ring; i < end; i++)
+            expand(near[i]);
+        ring = end;
+    }
+}
+
+// set &= rooms, in the time it takes to go over rooms
+void BeliefAgent::KeepOnly(RoomSet& set, const vector<int>& rooms) {
+    kept.clear();
+    for (int r : rooms)
+        if (set.Test(r))
+            kept.push_back(r);
+    set.Clear();
+    for (int r : kept)
+        set.Set(r);
+}
+
+// Chance of each room holding one of two alike things (pits, bats), given
+// the rooms they may be in and clues that each hold at least one of them.
+// A pair {a, b} fits when every clue holds a or b. A room in no clue pairs
+// only with the rooms in all of them, and a room in all of them with any
+// room; the rest can only pair with rooms in some clue, which are few,
+// so each of those is checked against each. A room's chance is the share
+// of fitting pairs it is in. Levels with some other number of them get it
+// spread evenly over the rooms left.
+void BeliefAgent::PairChances(const RoomSet& maybe, int count, const vector<vector<int>>& clues,
+                              int numClues, vector<double>& chance) {
+    fill(chance.begin(), chance.end(), 0.0);
+    int left = maybe.Count();
+    if (count != 2) {
+        maybe.ForEach([&](int a) { chance[a] = min(1.0, double(count) / left); });
+        return;
+    }
+    if (numClues == 0) {
+        // every pair fits
+        maybe.ForEach([&](int a) { chance[a] = left > 1 ? 2.0 / left : 1.0; });
+        return;
+    }
+
+    // which clues hold each room that is in any
+    clueRooms.clear();
+    for (int i = 0; i < numClues; i++) {
+        for (int r : clues[i]) {
+            if (clueSlot[r] < 0) {
+                clueSlot[r] = int(clueRooms.size());
+                clueRooms.push_back(r);
+                if (clueSets.size() < clueRooms.size())
+                    clueSets.emplace_back();
+                clueSets[clueSlot[r]].Resize(numClues);
+            }
+            clueSets[clueSlot[r]].Set(i);
+        }
+    }
+    clueCount.resize(clueRooms.size());
+    long inAll = 0;     // rooms that may hold one and are in every clue
+    for (size_t s = 0; s < clueRooms.size(); s++) {
+        clueCount[s] = clueSets[s].Count();
+        if (clueCount[s] == numClues && maybe.Test(clueRooms[s]))
+            inAll++;
+    }
+
+    long pairs = 0;
+    maybe.ForEach([&](int a) {
+        int s = clueSlot[a];
+        long n = 0;
+        if (s < 0) {
+            n = inAll;
+        } else if (clueCount[s] == numClues) {
+            n = left - 1;
+        } else {
+            for (size_t t = 0; t < clueRooms.size(); t++) {
+                int b = clueRooms[t];
+                if (b != a && maybe.Test(b)
+                    && clueCount[s] + clueCount[t] - clueSets[s].CountAnd(clueSets[t]) == numClues)
+                    n++;
+            }
+        }
+        chance[a] = double(n);
+        pairs += n;
+    });
+    for (int r : clueRooms)
+        clueSlot[r] = -1;
+
+    if (pairs == 0) {
+        // nothing fits (only one room left): spread the two over what is left
+        maybe.ForEach([&](int a) { chance[a] = left > 1 ? 2.0 / left : 1.0; });
+        return;
+    }
+    // pairs counts each {a, b} twice, once from each end
+    maybe.ForEach([&](int a) { chance[a] = chance[a] * 2.0 / pairs; });
+}
+
+// At the start the bats are somewhere in the deck; once they fly they can
+// be anywhere but room 0.
+void BeliefAgent::ResetBats(bool atStart) {
+    if (atStart) {
+        maybeBats = deck;
+    } else {
+        maybeBats.Fill();
+        maybeBats.Reset(0);
+    }
+    numBatClues = 0;
+    batClueRooms.Clear();
+}
+
+void BeliefAgent::ResetEnemy() {
+    enemiesLeft = numEnemies;
+    maybeEnemy.Clear();
+    if (enemyStart >= 0)
+        maybeEnemy.Set(enemyStart);
+    else
+        maybeEnemy = deck;
+    enemyMoved = false;
+}
+
+// Clues are kept from level to level and overwritten, so they stop
+// allocating once the longest list has been seen
+void BeliefAgent::AddClue(vector<vector<int>>& clues, int& numClues, RoomSet& from, int room,
+                          const vector<int>& rooms) {
+    if (from.Test(room))
+        return;
+    from.Set(room);
+    if (numClues < int(clues.size()))
+        clues[numClues] = rooms;
+    else
+        clues.push_back(rooms);
+    numClues++;
+}
+
+// What standing in room and hearing warnings says
+void BeliefAgent::Observe(int room, int heard) {
+    visited.Set(room);
+    maybePit.Reset(room);
+    maybeBats.Reset(room);
+    maybeEnemy.Reset(room);
+
+    Near(room, pitRadius);
+    if (heard & WARN_DRAFT)
+        AddClue(pitClues, numPitClues, pitClueRooms, room, near);
+    else
+        for (int r : near)
+            maybePit.Reset(r);
+    Near(room, batRadius);
+    if (heard & WARN_BATS)
+        AddClue(batClues, numBatClues, batClueRooms, room, near);
+    else
+        for (int r : near)
+            maybeBats.Reset(r);
+    // with more than one enemy a warning says one is near, not where the rest are
+    Near(room, enemyRadius);
+    if (!(heard & WARN_ENEMY))
+        for (int r : near)
+            maybeEnemy.Reset(r);
+    else if (numEnemies == 1)
+        KeepOnly(maybeEnemy, near);
+    if (!maybeEnemy.Any()) {
+        // lost track of it; start over from what this room says
+        maybeEnemy.Fill();
+        maybeEnemy.Reset(room);
+        if ((heard & WARN_ENEMY) && numEnemies == 1)
+            KeepOnly(maybeEnemy, near);
+    }
+    warnings = heard;
+}
+
+void BeliefAgent::Update(const StepResult& step) {
+    bool snatched = false;
+    bool spread = false;    // the enemies' moves this step, when there are several
+    for (int i = 0; i < step.numEvents; i++) {
+        const Event& event = step.events[i];
+        switch (event.type) {
+            case EventType::EnteredRoom:
+                Observe(event.room, event.value);
+                break;
+            case EventType::FoundWeapon:
+                if (find(weaponRooms.begin(), weaponRooms.end(), event.room) == weaponRooms.end())
+                    weaponRooms.push_back(event.room);
+                weaponsTaken.push_back(event.room);
+                break;
+            case EventType::BatSnatched: {
+                snatched = true;
+                visited.Set(event.room);
+                maybeEnemy.Reset(event.room);
+                bool saved = i + 1 < step.numEvents && step.events[i + 1].type == EventType::BatSaved;
+                if (!saved)
+                    maybePit.Reset(event.room);
+                break;
+            }
+            case EventType::BatSaved:
+            case EventType::FellInPit:
+                near.assign(1, event.room);
+                AddClue(pitClues, numPitClues, pitClueRooms, event.room, near);
+                break;
+            case EventType::KilledByEnemy:
+                if (!enemyMoved && numEnemies == 1)
+                    enemyStart = event.room;
+                break;
+            case EventType::KilledEnemy:
+                // only ends the level with the last one
+                enemiesLeft--;
+                maybeEnemy.Reset(event.room);
+                break;
+            case EventType::LevelRestarted:
+                // same pits and weapon room, everything else back where it started
+                ResetBats(true);
+                ResetEnemy();
+                weaponsTaken.clear();
+                break;
+            case EventType::EnemyStartled:
+                // the event names the room, but a player is not told that
+                if (attackRoom >= 0)
+                    maybeEnemy.Reset(attackRoom);
+                break;
+            case EventType::EnemyMoved:
+                // several enemies: each startled one may have moved, so
+                // spread them all once and keep where they were
+                if (numEnemies > 1 && spread)
+                    break;
+                scratch.Clear();
+                if (numEnemies > 1) {
+                    scratch = maybeEnemy;
+                    spread = true;
+                }
+                if (enemyMoves == EnemyMove::Random) {
+                    maybeEnemy.ForEach([&](int room) {
+                        for (int j = 0; j < cave->Degree(room); j++)
+                            scratch.Set(cave->Neighbors(room)[j]);
+                    });
+                } else {
+                    // only the tunnels that lead furthest from (nearest to) us
+                    int sign = enemyMoves == EnemyMove::Away ? -1 : 1;
+                    int us = step.state.room;
+                    maybeEnemy.ForEach([&](int room) {
+                        const int* nbr = cave->Neighbors(room);
+                        int best = numeric_limits<int>::max();
+                        for (int j = 0; j < cave->Degree(room); j++)
+                            best = min(best, sign * cave->Distance(nbr[j], us));
+                        for (int j = 0; j < cave->Degree(room); j++) {
+                            if (sign * cave->Distance(nbr[j], us) == best)
+                                scratch.Set(nbr[j]);
+                        }
+                    });
+                }
+                maybeEnemy = scratch;
+                enemyMoved = true;
+                break;
+            default:
+                break;
+        }
+    }
+    // the bats that had us flew off once we were dropped
+    if (snatched) {
+        ResetBats(false);
+        maybeBats.Reset(step.state.room);
+    }
+    attackRoom = -1;
+}
+
+// Turns the sets and clues into chances, and each room's chance of
+// killing us if we walk in
+void BeliefAgent::Infer(const Level& level) {
+    PairChances(maybePit, numPits, pitClues, numPitClues, pPit);
+    PairChances(maybeBats, numBats, batClues, numBatClues, pBats);
+    fill(pEnemy.begin(), pEnemy.end(), 0.0);
+    int enemyRooms = maybeEnemy.Count();
+    maybeEnemy.ForEach([&](int room) { pEnemy[room] = min(1.0, double(enemiesLeft) / enemyRooms); });
+
+    double hit = level.CanAttack() ? level.GetWeapon().pToHit : 0.0;
+    // the bats drop you in any room but 0 and theirs
+    double dropRisk = 0;
+    for (int r = 1; r < numRooms; r++)
+        dropRisk += pEnemy[r] * (1 - hit) + (1 - pEnemy[r]) * pPit[r];
+    dropRisk /= numRooms > 1 ? numRooms - 1 : 1;
+
+    for (int r = 0; r < numRooms; r++) {
+        // the enemy is met first, then the bats, then the pit
+        double rest = pBats[r] * dropRisk + (1 - pBats[r]) * pPit[r];
+        risk[r] = pEnemy[r] * (1 - hit) + (1 - pEnemy[r]) * rest;
+        score[r] = risk[r] - pEnemy[r] * hit;
+    }
+}
+
+// First step toward the nearest target reachable through safe rooms; if
+// there is none, toward the least deadly room next to the safe ones.
+int BeliefAgent::NextRoom(int from, const RoomSet& targets) {
+    fill(parent.begin(), parent.end(), -1);
+    queue.clear();
+    queue.push_back(from);
+    parent[from] = from;
+    int best = -1;
+    double bestScore = numeric_limits<double>::max();
+    int found = -1;
+
+    for (size_t i = 0; i < queue.size() && found < 0; i++) {
+        int room = queue[i];
+        for (int j = 0; j < cave->Degree(room); j++) {
+            int next = cave->Neighbors(room)[j];
+            if (parent[next] >= 0)
+                continue;
+            parent[next] = room;
+            if (risk[next] < SAFE) {
+                if (targets.Test(next)) {
+                    found = next;
+                    break;
+                }
+                queue.push_back(next);
+            } else {
+                // unsafe: a candidate, a little better if it is a target
+                double s = score[next] - (targets.Test(next) ? SAFE : 0);
+                if (s < bestScore) {
+                    bestScore = s;
+                    best = next;
+                }
+            }
+        }
+    }
+    if (found < 0)
+        found = best;
+    if (found < 0)
+        return -1;
+    while (parent[found] != from)
+        found = parent[found];
+    return found;
+}
+
+void BeliefAgent::BeginLevel(const Level& level, const StepResult& step) {
+    SetCave(level);
+    replaysLeft = maxReplays;
+    visited.Clear();
+    maybePit = deck;
+    numPitClues = 0;
+    pitClueRooms.Clear();
+    ResetBats(true);
+    weaponRooms.clear();
+    weaponsTaken.clear();
+    enemyStart = -1;
+    ResetEnemy();
+    warnings = 0;
+    attackRoom = -1;
+    Update(step);
+}
+
+Action BeliefAgent::Act(const Level& level, const StepResult& last) {
+    Update(last);
+
+    if (last.state.phase == LevelPhase::AwaitingReplay) {
+        if (replaysLeft > 0) {
+            replaysLeft--;
+            return {ActionType::Replay, -1};
+        }
+        return {ActionType::Quit, -1};
+    }
+    // out of ammo: nothing left to win with, unless some cache is still
+    // to be found or taken again
+    bool cachesLeft = int(weaponRooms.size()) < numWeapons || weaponsTaken.size() < weaponRooms.size();
+    if (last.state.haveWeapon && !level.CanAttack() && !cachesLeft)
+        return {ActionType::Quit, -1};
+
+    Infer(level);
+    int room = last.state.room;
+    const Weapon& weapon = level.GetWeapon();
+
+    bool enemyNext = false;
+    for (int j = 0; j < level.NumNeighbors(room); j++)
+        enemyNext = enemyNext || maybeEnemy.Test(level.Neighbors(room)[j]);
+    if (level.CanAttack() && enemyNext) {
+        // shoot where it most likely is; save limited ammo for good odds
+        int target = -1;
+        double p = 0;
+        for (int j = 0; j < level.NumNeighbors(room); j++) {
+            int next = level.Neighbors(room)[j];
+            if (pEnemy[next] > p) {
+                p = pEnemy[next];
+                target = next;
+            }
+        }
+        if (target >= 0 && (!weapon.isLimited || p >= 0.5 || ((warnings & WARN_ENEMY) && last.state.ammo > 1))) {
+            attackRoom = target;
+            return {ActionType::Attack, target};
+        }
+    }
+
+    // where to go: a weapon first, then next to where the enemy may be
+    RoomSet& targets = scratch;
+    if (!level.CanAttack()) {
+        targets.Clear();
+        for (int cache : weaponRooms)
+            if (find(weaponsTaken.begin(), weaponsTaken.end(), cache) == weaponsTaken.end())
+                targets.Set(cache);
+        if (!targets.Any()) {
+            targets.Fill();
+            targets.AndNot(visited);
+            if (last.state.haveWeapon && !targets.Any())
+                return {ActionType::Quit, -1};     // every room seen, no cache left
+        }
+    } else {
+        targets.Clear();
+        maybeEnemy.ForEach([&](int r) {
+            for (int j = 0; j < cave->Degree(r); j++)
+                targets.Set(cave->Neighbors(r)[j]);
+        });
+        if (!targets.Any()) {
+            targets.Fill();
+            targets.AndNot(visited);
+        }
+    }
+    targets.Reset(room);
+
+    int next = NextRoom(room, targets);
+    if (next < 0)
+        next = level.Neighbors(room)[rng(level.NumNeighbors(room))];
+    return {ActionType::Move, next};
+}
+
+unique_ptr<Agent> MakeAgent(const string& name, int replays) {
+    if (name == "random")
+        return unique_ptr<Agent>(new RandomAgent(replays));
+    if (name == "belief")
+        return unique_ptr<Agent>(new BeliefAgent(replays));
+    return nullptr;
+}
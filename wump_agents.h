@@ -0,0 +1,117 @@
+/*
+ * Wump.2 - agents that play a Level through the engine's step API
+ *
+ * An agent only gets what a player gets: the events of the last step,
+ * the level's public state and its tunnels. Level::Layout() is off limits.
+ */
+
+#ifndef WUMP_AGENTS_H
+#define WUMP_AGENTS_H
+
+#include "wump_engine.h"
+#include "wump_rng.h"
+#include "wump_roomset.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class Agent {
+public:
+    virtual ~Agent() {}
+    virtual const char* Name() const = 0;
+    // agents draw from their own stream, never the level's
+    virtual void Seed(uint64_t) {}
+    // called after Level::Start(), with its events
+    virtual void BeginLevel(const Level&, const StepResult&) {}
+    // decide the next action given the events of the last step
+    virtual Action Act(const Level&, const StepResult&) = 0;
+};
+
+// Wanders at random; attacks a random tunnel when it hears the enemy.
+class RandomAgent : public Agent {
+private:
+    int maxReplays;
+    int replaysLeft;
+    int warnings;   // from the last room entered
+    Rng rng;
+public:
+    RandomAgent(int replays = 0);
+    const char* Name() const { return "random"; }
+    void Seed(uint64_t seed) { rng.Seed(seed); }
+    void BeginLevel(const Level&, const StepResult&);
+    Action Act(const Level&, const StepResult&);
+};
+
+// Tracks where the pits, bats and enemy can be from the warnings heard so
+// far, one bit per room, and works out each room's chance of holding them.
+// Attacks when it hears the enemy, otherwise walks to the nearest useful
+// room through rooms known to be safe, or takes the least deadly step.
+// Knows the level's warning radii and how its enemy runs, and how many of
+// each thing the level places; pairs of pits and bats are worked out
+// exactly, other counts only roughly. Rooms near a room are walked from
+// the cave's tunnels when needed and clues keep only the rooms they name,
+// so memory and a turn's work grow with the rooms, not their square.
+class BeliefAgent : public Agent {
+private:
+    int maxReplays;
+    int replaysLeft;
+    const Cave* cave;
+    int numRooms;
+    int pitRadius, batRadius, enemyRadius;      // warnings are heard this many tunnels away
+    EnemyMove enemyMoves;
+    int numPits, numBats, numEnemies;           // the level's counts
+    int enemiesLeft;
+    RoomSet deck;                   // rooms things can start in
+    RoomSet visited;
+    RoomSet maybePit, maybeBats, maybeEnemy;
+    std::vector<std::vector<int>> pitClues, batClues;  // each holds at least one
+    int numPitClues, numBatClues;               // in use; the rest is spare memory
+    RoomSet pitClueRooms, batClueRooms;         // rooms the clues came from
+    RoomSet scratch;
+    int numWeapons;                     // caches the level deals
+    std::vector<int> weaponRooms;       // caches found, back in place after a replay
+    std::vector<int> weaponsTaken;      // of those, taken since the level (re)started
+    int enemyStart;     // -1 unless walked into before it ever moved
+    bool enemyMoved;
+    int warnings;       // of the current room
+    int attackRoom;     // of the last attack, -1 if none pending
+    std::vector<double> pPit, pBats, pEnemy, risk, score;
+    std::vector<int> parent, queue;
+    std::vector<int> near, kept;        // rooms of the last Near(), KeepOnly()'s scratch
+    std::vector<int> nearMark;          // nearMark[r] == nearStamp: r is in near
+    int nearStamp;
+    std::vector<int> clueSlot;          // -1, or the room's place in clueRooms
+    std::vector<int> clueRooms, clueCount;      // rooms in some clue, how many hold each
+    std::vector<RoomSet> clueSets;      // the clues that hold each, one bit per clue
+    Rng rng;
+
+    void SetCave(const Level&);
+    void Near(int room, int radius);
+    void KeepOnly(RoomSet&, const std::vector<int>& rooms);
+    void PairChances(const RoomSet& maybe, int count, const std::vector<std::vector<int>>& clues,
+                     int numClues, std::vector<double>& chance);
+    void ResetBats(bool atStart);
+    void ResetEnemy();
+    void AddClue(std::vector<std::vector<int>>&, int&, RoomSet&, int from, const std::vector<int>&);
+    void Observe(int room, int warnings);
+    void Update(const StepResult&);
+    void Infer(const Level&);
+    int  NextRoom(int from, const RoomSet& targets);
+
+public:
+    BeliefAgent(int replays = 0);
+    const char* Name() const { return "belief"; }
+    void Seed(uint64_t seed) { rng.Seed(seed); }
+    void BeginLevel(const Level&, const StepResult&);
+    Action Act(const Level&, const StepResult&);
+
+    // chances as of the last Act()
+    double PitChance(int room) const   { return pPit[room]; }
+    double BatsChance(int room) const  { return pBats[room]; }
+    double EnemyChance(int room) const { return pEnemy[room]; }
+};
+
+// nullptr if there is no agent by that name
+std::unique_ptr<Agent> MakeAgent(const std::string& name, int replays);
+
+#endif
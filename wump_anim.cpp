@@ -0,0 +1,91 @@
+/*
+ * Wump.2 - animation queue, see wump_anim.h
+ */
+
+#include "wump_anim.h"
+#include <chrono>
+#include <thread>
+#ifdef _WIN32
+    #include <conio.h>
+    #include <io.h>
+#else
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+using namespace std;
+
+// conx
+Animator::Animator(function<void(const string&)> drawFrame) {
+    draw = drawFrame;
+    turbo = false;
+    #ifdef _WIN32
+        watchInput = _isatty(0);
+    #else
+        watchInput = isatty(0);
+    #endif
+}
+
+void Animator::Queue(const string& name, int delayMs) {
+    frames.push_back({name, delayMs});
+}
+
+// Waits up to ms; returns true early if the player typed something
+bool Animator::WaitForInput(int ms) {
+    if (!watchInput) {
+        this_thread::sleep_for(chrono::milliseconds(ms));
+        return false;
+    }
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(ms);
+    for (;;) {
+        auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+        if (left <= 0)
+            return false;
+        #ifdef _WIN32
+            if (_kbhit())
+                return true;
+            this_thread::sleep_for(chrono::milliseconds(left < 15 ? left : 15));
+        #else
+            struct pollfd in = {0, POLLIN, 0};
+            int ready = poll(&in, 1, int(left));
+            if (ready > 0)
+                return true;
+            if (ready < 0)
+                return false;
+        #endif
+    }
+}
+
+// Throws away the keypress (or line) that skipped the sequence
+void Animator::DrainInput() {
+    #ifdef _WIN32
+        while (_kbhit())
+            _getch();
+    #else
+        char c;
+        struct pollfd in = {0, POLLIN, 0};
+        while (poll(&in, 1, 0) > 0 && read(0, &c, 1) == 1) {
+            if (c == '\n')
+                break;
+        }
+    #endif
+}
+
+// Plays the queued frames. Returns true if the player skipped them.
+bool Animator::Play() {
+    bool skipped = false;
+    size_t n = frames.size();
+    for (size_t i = 0; i < n; i++) {
+        draw(frames[i].name);
+        if (turbo || frames[i].delayMs <= 0)
+            continue;
+        if (WaitForInput(frames[i].delayMs)) {
+            DrainInput();
+            if (i + 1 < n)
+                draw(frames[n - 1].name);
+            skipped = true;
+            break;
+        }
+    }
+    frames.clear();
+    return skipped;
+}
@@ -0,0 +1,44 @@
+/*
+ * Wump.2 - animation queue
+ *
+ * Frames are queued with their display time in milliseconds and played
+ * back against a clock. While a frame is showing the player can press
+ * Enter to skip the rest of the sequence: the last frame is drawn and
+ * play returns right away. In turbo mode nothing waits at all.
+ *
+ * Skipping only watches the keyboard when stdin is a terminal, so piped
+ * input is never swallowed as a skip.
+ */
+
+#ifndef WUMP_ANIM_H
+#define WUMP_ANIM_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+const int FRAME_MS = 1000;  // how long an image stays up by default
+
+class Animator {
+private:
+    struct Frame {
+        std::string name;
+        int delayMs;
+    };
+    std::vector<Frame> frames;
+    std::function<void(const std::string&)> draw;
+    bool turbo;
+    bool watchInput;
+
+    bool WaitForInput(int ms);
+    void DrainInput();
+
+public:
+    Animator(std::function<void(const std::string&)> drawFrame);
+    void SetTurbo(bool on) { turbo = on; }
+    bool Turbo() const { return turbo; }
+    void Queue(const std::string& name, int delayMs = FRAME_MS);
+    bool Play();
+};
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ * Wump.2 - packed ASCII art bundle, see wump_assets.h
+ */
+
+#include "wump_assets.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#ifdef _WIN32
+    #include <windows.h>
+    #include <io.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+#ifdef WUMP_EMBED_ASSETS
+    #include "wump_assets_embed.h"     // generated by wump_pack --header
+#endif
+using namespace std;
+
+static const size_t kHeaderSize = 16;
+
+static uint32_t ReadU32(const unsigned char* p) {
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+// conx
+AssetBundle::AssetBundle() {
+    base = nullptr;
+    size = 0;
+    count = 0;
+    mapped = false;
+}
+
+AssetBundle::~AssetBundle() {
+    Close();
+}
+
+void AssetBundle::Close() {
+    if (base != nullptr && mapped) {
+        #ifdef _WIN32
+            delete[] base;
+        #else
+            munmap((void*)base, size);
+        #endif
+    }
+    base = nullptr;
+    size = 0;
+    count = 0;
+    mapped = false;
+}
+
+// Checks the header and that every entry lies inside the bundle
+bool AssetBundle::OpenMemory(const unsigned char* data, size_t length) {
+    if (length < kHeaderSize || memcmp(data, WUMP_PAK_MAGIC, sizeof(WUMP_PAK_MAGIC)) != 0)
+        return false;
+    uint32_t n = ReadU32(data + 8);
+    if (n > (length - kHeaderSize) / sizeof(PakEntry))
+        return false;
+    for (uint32_t i = 0; i < n; i++) {
+        const unsigned char* e = data + kHeaderSize + i * sizeof(PakEntry);
+        uint64_t nameEnd = uint64_t(ReadU32(e)) + ReadU32(e + 4);
+        uint64_t dataEnd = uint64_t(ReadU32(e + 8)) + ReadU32(e + 12);
+        if (nameEnd > length || dataEnd > length)
+            return false;
+    }
+    Close();
+    base = data;
+    size = length;
+    count = n;
+    return true;
+}
+
+// Maps the bundle file. On Windows it is read into memory once instead.
+bool AssetBundle::Open(const string& path) {
+    #ifdef _WIN32
+        ifstream file(path, ios::binary | ios::ate);
+        if (!file.is_open())
+            return false;
+        size_t length = size_t(file.tellg());
+        unsigned char* data = new unsigned char[length];
+        file.seekg(0);
+        file.read((char*)data, length);
+        if (!file || !OpenMemory(data, length)) {
+            delete[] data;
+            return false;
+        }
+        mapped = true;
+        return true;
+    #else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        size_t length = size_t(st.st_size);
+        void* data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            return false;
+        if (!OpenMemory((const unsigned char*)data, length)) {
+            munmap(data, length);
+            return false;
+        }
+        mapped = true;
+        return true;
+    #endif
+}
+
+// directory of the running executable, "" if unknown
+static string ExecutableDir() {
+    char path[4096];
+    #ifdef _WIN32
+        DWORD n = GetModuleFileNameA(NULL, path, sizeof(path));
+        if (n == 0 || n == sizeof(path))
+            return "";
+    #else
+        ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);     // Linux
+        if (n <= 0)
+            n = readlink("/proc/self/path/a.out", path, sizeof(path) - 1);  // Solaris
+        if (n <= 0)
+            return "";
+        path[n] = '\0';
+    #endif
+    string dir(path);
+    size_t slash = dir.find_last_of("/\\");
+    return slash == string::npos ? "" : dir.substr(0, slash + 1);
+}
+
+// Finds the bundle: compiled in, $WUMP_ASSETS, next to the executable,
+// then the current directory.
+bool AssetBundle::OpenDefault() {
+    #ifdef WUMP_EMBED_ASSETS
+        if (OpenMemory(wumpEmbeddedPak, sizeof(wumpEmbeddedPak)))
+            return true;
+    #endif
+    const char* env = getenv("WUMP_ASSETS");
+    if (env != nullptr && Open(env))
+        return true;
+    string dir = ExecutableDir();
+    if (!dir.empty() && Open(dir + WUMP_PAK_FILE))
+        return true;
+    return Open(WUMP_PAK_FILE);
+}
+
+// Binary search of the index; data points into the bundle
+bool AssetBundle::Find(const string& name, const char** data, size_t* length) const {
+    uint32_t lo = 0, hi = count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const unsigned char* e = base + kHeaderSize + mid * sizeof(PakEntry);
+        string_view entryName((const char*)base + ReadU32(e), ReadU32(e + 4));
+        int cmp = entryName.compare(name);
+        if (cmp == 0) {
+            *data = (const char*)base + ReadU32(e + 8);
+            *length = ReadU32(e + 12);
+            return true;
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return false;
+}
+
+// Writes the image to fd in one write (more only if the write is partial)
+bool AssetBundle::Write(const string& name, int fd) const {
+    const char* data;
+    size_t length;
+    if (!Find(name, &data, &length))
+        return false;
+    while (length > 0) {
+        #ifdef _WIN32
+            int n = _write(fd, data, (unsigned)length);
+        #else
+            ssize_t n = write(fd, data, length);
+        #endif
+        if (n <= 0)
+            return false;
+        data += n;
+        length -= size_t(n);
+    }
+    return true;
+}
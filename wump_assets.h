@@ -0,0 +1,57 @@
+/*
+ * Wump.2 - packed ASCII art bundle
+ *
+ * All the ascii_img files packed into one file with an index, built by
+ * wump_pack. The bundle is memory-mapped once at startup (or compiled in
+ * with WUMP_EMBED_ASSETS) and an image is written straight from the
+ * mapping to stdout with a single write.
+ *
+ * Layout, all integers little-endian uint32:
+ *   magic "WUMPPAK1", count, reserved
+ *   count x { nameOffset, nameLength, dataOffset, dataLength }, sorted by name
+ *   names, then data; offsets are from the start of the bundle
+ */
+
+#ifndef WUMP_ASSETS_H
+#define WUMP_ASSETS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+const char WUMP_PAK_MAGIC[8] = {'W', 'U', 'M', 'P', 'P', 'A', 'K', '1'};
+const char WUMP_PAK_FILE[] = "ascii_img.pak";
+
+struct PakEntry {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t dataOffset;
+    uint32_t dataLength;
+};
+
+class AssetBundle {
+private:
+    const unsigned char* base;
+    size_t   size;
+    uint32_t count;
+    bool     mapped;    // base came from Open() and must be unmapped
+
+    void Close();
+
+public:
+    AssetBundle();
+    ~AssetBundle();
+    AssetBundle(const AssetBundle&) = delete;
+    AssetBundle& operator=(const AssetBundle&) = delete;
+
+    bool Open(const std::string& path);
+    bool OpenMemory(const unsigned char* data, size_t length);
+    bool OpenDefault();
+    bool IsOpen() const { return base != nullptr; }
+    uint32_t Count() const { return count; }
+
+    bool Find(const std::string& name, const char** data, size_t* length) const;
+    bool Write(const std::string& name, int fd) const;
+};
+
+#endif
@@ -0,0 +1,393 @@
+/*
+ * wump_bench - microbenchmarks of the engine's hot paths
+ *
+ * usage: wump_bench [--min-time S] [--filter TEXT] [--json FILE]
+ *                   [--cave SPEC] [--assets PAK]
+ *
+ * Each benchmark is calibrated to run for about S seconds (0.2) and the
+ * best of three runs is reported in nanoseconds per operation. --filter
+ * runs only the benchmarks whose name contains TEXT. --json writes the
+ * results to FILE ("-" for stdout) as
+ *
+ *   {"context": {...}, "benchmarks": [{"name", "iterations", "ns_per_op"}, ...]}
+ *
+ * so one release can be compared with the next. The render benchmarks
+ * need the asset bundle (ascii_img.pak, found like the game finds it, or
+ * --assets) and are skipped without it.
+ *
+ *   level_start        Start(): the sampler shuffle, dealing the layout
+ *                      and the first InspectCurrentRoom()
+ *   level_generate     LevelGenerator::Prepare() with --safe-levels, then Start()
+ *   level_pool         LevelPool::Prepare() then Start(), draining the pool
+ *                      while its workers refill it (one per core)
+ *   inspect_room       Step(Move) between two empty rooms, the turn path
+ *                      through InspectCurrentRoom()
+ *   snapshot_restore   Level::Restore(), the baseline for startled_enemy
+ *   startled_enemy     Restore() then a missed Step(Attack): MoveStartledEnemy()
+ *   game_random        one whole headless game by RandomAgent
+ *   game_belief        one whole headless game by BeliefAgent
+ *   asset_find         AssetBundle::Find() of an image by name
+ *   catfile            Find() then Screen::Present() to /dev/null, as CatFile does
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+#include "wump_engine.h"
+#include "wump_agents.h"
+#include "wump_levelgen.h"
+#include "wump_assets.h"
+#include "wump_render.h"
+using namespace std;
+using Clock = chrono::steady_clock;
+
+const int MAX_TURNS = 1000;
+
+// results go here so the compiler cannot drop the work
+volatile uint64_t sink;
+
+struct BenchResult {
+    string name;
+    long iterations;
+    double nsPerOp;
+};
+
+// Runs body(n) with n doubling until one run takes a tenth of minTime,
+// then three runs of about minTime / 3 each; the fastest counts.
+template <class Body>
+BenchResult Measure(const string& name, double minTime, Body body) {
+    long n = 1;
+    double secs = 0;
+    for (;;) {
+        auto t0 = Clock::now();
+        body(n);
+        secs = chrono::duration<double>(Clock::now() - t0).count();
+        if (secs >= minTime / 10 || n >= (1L << 40))
+            break;
+        n *= 2;
+    }
+    long runN = max(1L, long(n * (minTime / 3) / max(secs, 1e-9)));
+    double best = 0;
+    for (int run = 0; run < 3; run++) {
+        auto t0 = Clock::now();
+        body(runN);
+        double ns = chrono::duration<double, nano>(Clock::now() - t0).count() / double(runN);
+        if (run == 0 || ns < best)
+            best = ns;
+    }
+    return {name, runN, best};
+}
+
+// Plays one whole game like wump_sim does
+void PlayOneGame(Game& game, Agent& agent, uint64_t seed) {
+    game.Reset();
+    game.Seed(seed);
+    agent.Seed(seed);
+    bool over = false, won = false;
+    while (!over && !won) {
+        Level& level = game.CurrentLevel();
+        StepResult step = level.Start();
+        agent.BeginLevel(level, step);
+        for (int turn = 0; step.state.phase != LevelPhase::Over; turn++) {
+            Action action = turn == MAX_TURNS ? Action{ActionType::Quit, -1} : agent.Act(level, step);
+            step = level.Step(action);
+        }
+        over = !level.Result().killedEnemy;
+        won = game.RecordResult(level.Result());
+    }
+    sink = sink + uint64_t(game.CurrentLevelNum());
+}
+
+// Whether anything of the layout is in room
+bool Occupied(const LevelLayout& layout, int room) {
+    for (const vector<int>* rooms : {&layout.enemyRooms, &layout.relocRooms, &layout.hazRooms,
+                                     &layout.weaponRooms}) {
+        if (find(rooms->begin(), rooms->end(), room) != rooms->end())
+            return true;
+    }
+    return false;
+}
+
+// A room next to from that holds nothing and is not avoid, -1 if none
+int EmptyNeighbor(const Level& level, const LevelLayout& layout, int from, int avoid) {
+    for (int j = 0; j < level.NumNeighbors(from); j++) {
+        int room = level.Neighbors(from)[j];
+        if (room != avoid && !Occupied(layout, room) && room != 0)
+            return room;
+    }
+    return -1;
+}
+
+string JsonString(const string& text) {
+    string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if (uint8_t(c) >= 0x20)
+            out += c;
+    }
+    return out + "\"";
+}
+
+int main(int argc, char* argv[]) {
+    double minTime = 0.2;
+    string filter;
+    const char* jsonPath = nullptr;
+    const char* assetsPath = nullptr;
+    CaveSpec caveSpec;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--min-time") == 0 && hasValue) {
+            minTime = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && hasValue) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && hasValue) {
+            jsonPath = argv[++i];
+        } else if (strcmp(argv[i], "--assets") == 0 && hasValue) {
+            assetsPath = argv[++i];
+        } else if (strcmp(argv[i], "--cave") == 0 && hasValue) {
+            if (!ParseCaveSpec(argv[++i], &caveSpec)) {
+                cerr << "wump_bench: bad cave " << argv[i] << endl;
+                return 2;
+            }
+        } else {
+            cerr << "usage: wump_bench [--min-time S] [--filter TEXT] [--json FILE] "
+                 << "[--cave SPEC] [--assets PAK]" << endl;
+            return 2;
+        }
+    }
+    if (minTime <= 0)
+        minTime = 0.2;
+
+    Cave cave = Cave::Dodecahedron();
+    try {
+        cave = Cave::Build(caveSpec);
+    } catch (const exception& e) {
+        cerr << "wump_bench: " << e.what() << endl;
+        return 2;
+    }
+    auto wanted = [&](const char* name) { return filter.empty() || strstr(name, filter.c_str()) != nullptr; };
+    vector<BenchResult> results;
+    vector<string> skipped;
+
+    if (wanted("level_start")) {
+        Level level(0, cave);
+        level.Seed(1);
+        results.push_back(Measure("level_start", minTime, [&](long n) {
+            for (long i = 0; i < n; i++)
+                sink = sink + uint64_t(level.Start().state.room);
+        }));
+    }
+    LevelRules rules;
+    rules.safeWeapon = true;
+    if (wanted("level_generate")) {
+        Level level(0, cave);
+        level.Seed(1);
+        LevelGenerator generator(cave, rules);
+        results.push_back(Measure("level_generate", minTime, [&](long n) {
+            for (long i = 0; i < n; i++) {
+                generator.Prepare(level);
+                sink = sink + uint64_t(level.Start().state.room);
+            }
+        }));
+    }
+    if (wanted("level_pool")) {
+        Level level(0, cave);
+        LevelPool pool(cave, LevelTable::Default(), rules, 1, 4096, 0, 1);
+        results.push_back(Measure("level_pool", minTime, [&](long n) {
+            for (long i = 0; i < n; i++) {
+                pool.Prepare(level);
+                sink = sink + uint64_t(level.Start().state.room);
+            }
+        }));
+    }
+
+    // a level with the player between two empty rooms a and b; any
+    // seed will do that has them
+    Level level(0, cave);
+    vector<char> atA(level.SnapshotSize());
+    LevelSnapshot head;             // the fixed part of a snapshot, to change
+    int roomA = -1, roomB = -1, target = -1;
+    for (uint64_t seed = 1; seed < 1000 && target < 0; seed++) {
+        level.Seed(seed);
+        level.Start();
+        const LevelLayout& layout = level.Layout();
+        for (int a = 1; a < level.NumRooms() && target < 0; a++) {
+            if (EmptyNeighbor(level, layout, a, -1) < 0 || Occupied(layout, a)
+                || level.GetCave().IsAdjacent(a, layout.enemyRooms[0]))
+                continue;
+            roomA = a;
+            roomB = EmptyNeighbor(level, layout, a, -1);
+            target = EmptyNeighbor(level, layout, a, roomB);
+        }
+    }
+    if (target >= 0) {
+        level.Save(atA.data());
+        memcpy(&head, atA.data(), sizeof(head));
+        head.currentRoom = roomA;
+        memcpy(atA.data(), &head, sizeof(head));
+        level.Restore(atA.data());
+    }
+
+    if (wanted("inspect_room") && target >= 0) {
+        level.Restore(atA.data());
+        results.push_back(Measure("inspect_room", minTime, [&](long n) {
+            for (long i = 0; i < n; i++)
+                sink = sink + uint64_t(level.Step({ActionType::Move, (i & 1) ? roomA : roomB}).numEvents);
+        }));
+    }
+
+    // armed with ammo to spare, attacking an empty room
+    vector<char> armed = atA;
+    head.haveWeapon = 1;
+    head.ammo = 1 << 30;
+    if (wanted("snapshot_restore") && target >= 0) {
+        results.push_back(Measure("snapshot_restore", minTime, [&](long n) {
+            for (long i = 0; i < n; i++) {
+                head.rng[0] = uint64_t(i);      // a different draw each time
+                memcpy(armed.data(), &head, sizeof(head));
+                level.Restore(armed.data());
+                sink = sink + uint64_t(level.State().room);
+            }
+        }));
+    }
+    if (wanted("startled_enemy") && target >= 0) {
+        results.push_back(Measure("startled_enemy", minTime, [&](long n) {
+            for (long i = 0; i < n; i++) {
+                head.rng[0] = uint64_t(i);
+                memcpy(armed.data(), &head, sizeof(head));
+                level.Restore(armed.data());
+                sink = sink + uint64_t(level.Step({ActionType::Attack, target}).numEvents);
+            }
+        }));
+    }
+    if (target < 0 && (wanted("inspect_room") || wanted("startled_enemy")))
+        skipped.push_back("inspect_room, snapshot_restore, startled_enemy: no level with two empty rooms");
+
+    if (wanted("game_random") || wanted("game_belief")) {
+        Game game(cave);
+        RandomAgent randomAgent;
+        BeliefAgent beliefAgent;
+        uint64_t seed = 0;
+        if (wanted("game_random")) {
+            results.push_back(Measure("game_random", minTime, [&](long n) {
+                for (long i = 0; i < n; i++)
+                    PlayOneGame(game, randomAgent, ++seed);
+            }));
+        }
+        if (wanted("game_belief")) {
+            results.push_back(Measure("game_belief", minTime, [&](long n) {
+                for (long i = 0; i < n; i++)
+                    PlayOneGame(game, beliefAgent, ++seed);
+            }));
+        }
+    }
+
+    if (wanted("asset_find") || wanted("catfile")) {
+        AssetBundle assets;
+        bool haveAssets = assetsPath ? assets.Open(assetsPath) : assets.OpenDefault();
+        #ifdef _WIN32
+            int nullFd = _open("NUL", _O_WRONLY);
+        #else
+            int nullFd = open("/dev/null", O_WRONLY);
+        #endif
+        const vector<string> names = {"bat", "bow", "gold", "instructions", "map", "pit", "title", "wump"};
+        if (!haveAssets || nullFd < 0) {
+            skipped.push_back("asset_find, catfile: no asset bundle");
+        } else {
+            const char* data;
+            size_t length;
+            if (wanted("asset_find")) {
+                results.push_back(Measure("asset_find", minTime, [&](long n) {
+                    for (long i = 0; i < n; i++) {
+                        if (assets.Find(names[size_t(i) % names.size()], &data, &length))
+                            sink = sink + length;
+                    }
+                }));
+            }
+            if (wanted("catfile")) {
+                Screen screen(nullFd);
+                results.push_back(Measure("catfile", minTime, [&](long n) {
+                    for (long i = 0; i < n; i++) {
+                        if (assets.Find(names[size_t(i) % names.size()], &data, &length))
+                            screen.Present(data, length);
+                    }
+                }));
+            }
+        }
+        if (nullFd >= 0) {
+            #ifdef _WIN32
+                _close(nullFd);
+            #else
+                close(nullFd);
+            #endif
+        }
+    }
+
+    bool jsonToStdout = jsonPath && strcmp(jsonPath, "-") == 0;
+    if (!jsonToStdout) {
+        cout << "cave " << CaveSpecName(caveSpec) << " (" << cave.NumRooms() << " rooms)" << endl;
+        for (const BenchResult& r : results) {
+            cout << r.name << string(20 - min<size_t>(19, r.name.size()), ' ')
+                 << r.nsPerOp << " ns/op  (" << r.iterations << " iterations)" << endl;
+        }
+        for (const string& s : skipped)
+            cout << "skipped " << s << endl;
+    }
+
+    if (jsonPath) {
+        string json = "{\n  \"context\": {";
+        char date[32];
+        time_t now = time(nullptr);
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+        json += "\"date\": " + JsonString(date);
+        #if defined(__VERSION__)
+            json += ", \"compiler\": " + JsonString(__VERSION__);
+        #elif defined(_MSC_VER)
+            json += ", \"compiler\": " + JsonString("MSVC " + to_string(_MSC_VER));
+        #endif
+        #ifdef NDEBUG
+            json += ", \"build\": \"release\"";
+        #else
+            json += ", \"build\": \"debug\"";
+        #endif
+        json += ", \"cave\": " + JsonString(CaveSpecName(caveSpec));
+        json += ", \"min_time\": " + to_string(minTime);
+        json += "},\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            json += i ? ",\n    " : "\n    ";
+            json += "{\"name\": " + JsonString(results[i].name)
+                  + ", \"iterations\": " + to_string(results[i].iterations)
+                  + ", \"ns_per_op\": " + to_string(results[i].nsPerOp) + "}";
+        }
+        json += "\n  ],\n  \"skipped\": [";
+        for (size_t i = 0; i < skipped.size(); i++)
+            json += (i ? ", " : "") + JsonString(skipped[i]);
+        json += "]\n}\n";
+        if (jsonToStdout) {
+            cout << json;
+        } else {
+            ofstream out(jsonPath, ios::trunc);
+            out << json;
+            if (!out) {
+                cerr << "wump_bench: cannot write " << jsonPath << endl;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
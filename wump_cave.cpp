@@ -0,0 +1,332 @@
+/*
+ * Wump.2 - cave topologies, see wump_cave.h
+ */
+
+#include "wump_cave.h"
+#include "wump_rng.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+using namespace std;
+
+typedef vector<pair<int, int>> EdgeList;
+
+// constant value 2d array to represent the dodecahedron room structure
+// rooms are thus 0 - 19
+static const int adjacentRooms[20][3] = {
+    {1, 4, 7},    {0, 2, 9},   {1, 3, 11},   {2, 4, 13},   {0, 3, 5},
+    {4, 6, 14},   {5, 7, 16},  {0, 6, 8},    {7, 9, 17},   {1, 8, 10},
+    {9, 11, 18},  {2, 10, 12}, {11, 13, 19}, {3, 12, 14},  {5, 13, 15},
+    {14, 16, 19}, {6, 15, 17}, {8, 16, 18},  {10, 17, 19}, {12, 15, 18}
+};
+
+// Parses "kind[:WxH|:N[:SEED]]", see wump_cave.h
+bool ParseCaveSpec(const string& text, CaveSpec* spec) {
+    string kind = text, args;
+    size_t colon = text.find(':');
+    if (colon != string::npos) {
+        kind = text.substr(0, colon);
+        args = text.substr(colon + 1);
+    }
+    CaveSpec parsed;
+    if (kind == "dodecahedron" && args.empty()) {
+        parsed.kind = CaveKind::Dodecahedron;
+    } else if (kind == "icosahedron" && args.empty()) {
+        parsed.kind = CaveKind::TruncatedIcosahedron;
+    } else if (kind == "torus" || kind == "grid") {
+        parsed.kind = kind == "torus" ? CaveKind::Torus : CaveKind::Grid;
+        char* end;
+        long w = strtol(args.c_str(), &end, 10);
+        if (*end != 'x')
+            return false;
+        long h = strtol(end + 1, &end, 10);
+        if (*end != '\0' || w < 1 || h < 1 || w * h > 100000000)
+            return false;
+        // a torus needs 3 rooms a side or tunnels would double up
+        if (parsed.kind == CaveKind::Torus && (w < 3 || h < 3))
+            return false;
+        parsed.width = int(w);
+        parsed.height = int(h);
+    } else if (kind == "cubic") {
+        parsed.kind = CaveKind::RandomCubic;
+        char* end;
+        long n = strtol(args.c_str(), &end, 10);
+        if (*end == ':')
+            parsed.seed = strtoull(end + 1, &end, 10);
+        if (*end != '\0' || n < 4 || n % 2 != 0 || n > 100000000)
+            return false;
+        parsed.width = int(n);
+    } else {
+        return false;
+    }
+    *spec = parsed;
+    return true;
+}
+
+string CaveSpecName(const CaveSpec& spec) {
+    switch (spec.kind) {
+        case CaveKind::Dodecahedron:
+            return "dodecahedron";
+        case CaveKind::TruncatedIcosahedron:
+            return "icosahedron";
+        case CaveKind::Torus:
+            return "torus:" + to_string(spec.width) + "x" + to_string(spec.height);
+        case CaveKind::Grid:
+            return "grid:" + to_string(spec.width) + "x" + to_string(spec.height);
+        case CaveKind::RandomCubic:
+            return "cubic:" + to_string(spec.width) + ":" + to_string(spec.seed);
+    }
+    return "";
+}
+
+// conx - edges are undirected, listed once each
+Cave::Cave(const CaveSpec& caveSpec, int rooms, EdgeList& edges) {
+    spec = caveSpec;
+    numRooms = rooms;
+    offsets.assign(size_t(rooms) + 1, 0);
+    for (const auto& edge : edges) {
+        offsets[edge.first + 1]++;
+        offsets[edge.second + 1]++;
+    }
+    for (int r = 0; r < rooms; r++)
+        offsets[r + 1] += offsets[r];
+
+    neighbors.resize(offsets[rooms]);
+    vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (const auto& edge : edges) {
+        neighbors[fill[edge.first]++] = edge.second;
+        neighbors[fill[edge.second]++] = edge.first;
+    }
+    // tunnels listed in ascending room order, like the original table
+    for (int r = 0; r < rooms; r++)
+        sort(neighbors.begin() + offsets[r], neighbors.begin() + offsets[r + 1]);
+    if (rooms <= kMaxDistanceRooms)
+        BuildDistances();
+}
+
+#ifdef _MSC_VER
+static size_t LowBit(uint64_t w) { unsigned long i; _BitScanForward64(&i, w); return size_t(i); }
+#else
+static size_t LowBit(uint64_t w) { return size_t(__builtin_ctzll(w)); }
+#endif
+
+// Breadth-first from every room at once, one bit per room: after round d,
+// reach[a] is every room within d tunnels of a, the OR of its neighbors'
+// sets from round d - 1. The bits new in round d are the rooms exactly d
+// away. Each round is a word-wide OR per tunnel, so the whole table costs
+// rooms * tunnels * (rooms / 64) per round, rounds being the diameter.
+void Cave::BuildDistances() {
+    size_t n = size_t(numRooms);
+    size_t words = (n + 63) / 64;
+    distances.assign(n * n, uint8_t(kFar));
+    vector<uint64_t> reach(n * words, 0), next(n * words, 0);
+    for (size_t a = 0; a < n; a++) {
+        reach[a * words + a / 64] |= uint64_t(1) << (a % 64);
+        distances[a * n + a] = 0;
+    }
+    bool grew = true;
+    for (int d = 1; d < kFar && grew; d++) {
+        grew = false;
+        for (size_t a = 0; a < n; a++) {
+            uint64_t* out = &next[a * words];
+            const uint64_t* own = &reach[a * words];
+            for (size_t w = 0; w < words; w++)
+                out[w] = own[w];
+            for (int j = 0; j < Degree(int(a)); j++) {
+                const uint64_t* in = &reach[size_t(Neighbors(int(a))[j]) * words];
+                for (size_t w = 0; w < words; w++)
+                    out[w] |= in[w];
+            }
+            for (size_t w = 0; w < words; w++) {
+                for (uint64_t fresh = out[w] & ~own[w]; fresh; fresh &= fresh - 1) {
+                    distances[a * n + w * 64 + LowBit(fresh)] = uint8_t(d);
+                    grew = true;
+                }
+            }
+        }
+        reach.swap(next);
+    }
+}
+
+bool Cave::IsAdjacent(int roomA, int roomB) const {
+    const int* nbr = Neighbors(roomA);
+    int degree = Degree(roomA);
+    for (int j = 0; j < degree; j++) {
+        if (nbr[j] == roomB)
+            return true;
+    }
+    return false;
+}
+
+static EdgeList DodecahedronEdges() {
+    EdgeList edges;
+    for (int r = 0; r < 20; r++) {
+        for (int j = 0; j < 3; j++) {
+            if (r < adjacentRooms[r][j])
+                edges.push_back({r, adjacentRooms[r][j]});
+        }
+    }
+    return edges;
+}
+
+// Truncating the icosahedron cuts every corner off: each of its 12
+// vertices becomes a pentagon. Room (u,v) is the corner of u's pentagon on
+// the edge towards v; it connects to (v,u) across that edge and to (u,w)
+// for the two w that form a triangle with u and v.
+static EdgeList TruncatedIcosahedronEdges() {
+    const double phi = (1 + sqrt(5.0)) / 2;
+    double pts[12][3];
+    int n = 0;
+    for (int a = -1; a <= 1; a += 2) {
+        for (int b = -1; b <= 1; b += 2) {
+            double p[3] = {0, double(a), b * phi};
+            for (int k = 0; k < 3; k++) {
+                pts[n][k] = p[k];
+                pts[n + 1][k] = p[(k + 1) % 3];
+                pts[n + 2][k] = p[(k + 2) % 3];
+            }
+            n += 3;
+        }
+    }
+    bool adjacent[12][12] = {};
+    for (int u = 0; u < 12; u++) {
+        for (int v = 0; v < 12; v++) {
+            double d = 0;
+            for (int k = 0; k < 3; k++)
+                d += (pts[u][k] - pts[v][k]) * (pts[u][k] - pts[v][k]);
+            adjacent[u][v] = u != v && fabs(d - 4) < 1e-6;    // edge length 2
+        }
+    }
+
+    int corner[12][12];
+    int rooms = 0;
+    for (int u = 0; u < 12; u++) {
+        for (int v = 0; v < 12; v++)
+            corner[u][v] = adjacent[u][v] ? rooms++ : -1;
+    }
+    EdgeList edges;
+    for (int u = 0; u < 12; u++) {
+        for (int v = 0; v < 12; v++) {
+            if (!adjacent[u][v])
+                continue;
+            if (u < v)
+                edges.push_back({corner[u][v], corner[v][u]});
+            for (int w = v + 1; w < 12; w++) {
+                if (adjacent[u][w] && adjacent[v][w])
+                    edges.push_back({corner[u][v], corner[u][w]});
+            }
+        }
+    }
+    return edges;
+}
+
+static EdgeList GridEdges(int w, int h, bool wrap) {
+    EdgeList edges;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int room = y * w + x;
+            if (x + 1 < w)
+                edges.push_back({room, room + 1});
+            else if (wrap)
+                edges.push_back({y * w, room});
+            if (y + 1 < h)
+                edges.push_back({room, room + w});
+            else if (wrap)
+                edges.push_back({x, room});
+        }
+    }
+    return edges;
+}
+
+static bool IsConnected(int rooms, const Cave& cave) {
+    vector<char> seen(rooms, 0);
+    vector<int> todo(1, 0);
+    seen[0] = 1;
+    int reached = 1;
+    while (!todo.empty()) {
+        int room = todo.back();
+        todo.pop_back();
+        for (int j = 0; j < cave.Degree(room); j++) {
+            int next = cave.Neighbors(room)[j];
+            if (!seen[next]) {
+                seen[next] = 1;
+                reached++;
+                todo.push_back(next);
+            }
+        }
+    }
+    return reached == rooms;
+}
+
+// Pairs up three tunnel ends per room at random and starts over on a
+// loop or a doubled tunnel (the configuration model); about 1 in 8 tries
+// succeeds whatever the size.
+static EdgeList RandomCubicEdges(int rooms, Rng& rng) {
+    vector<int> ends(size_t(rooms) * 3);
+    vector<int> nbr(size_t(rooms) * 3);
+    vector<unsigned char> degree(rooms);
+    for (;;) {
+        for (size_t i = 0; i < ends.size(); i++)
+            ends[i] = int(i / 3);
+        for (size_t i = ends.size() - 1; i > 0; i--)
+            swap(ends[i], ends[rng.Below(uint32_t(i + 1))]);
+        fill(degree.begin(), degree.end(), 0);
+
+        EdgeList edges;
+        edges.reserve(ends.size() / 2);
+        bool ok = true;
+        for (size_t i = 0; ok && i < ends.size(); i += 2) {
+            int a = ends[i], b = ends[i + 1];
+            for (int j = 0; j < degree[a]; j++)
+                ok = ok && nbr[size_t(a) * 3 + j] != b;
+            if (!ok || a == b) {
+                ok = false;
+                break;
+            }
+            nbr[size_t(a) * 3 + degree[a]++] = b;
+            nbr[size_t(b) * 3 + degree[b]++] = a;
+            edges.push_back({a, b});
+        }
+        if (ok)
+            return edges;
+    }
+}
+
+const Cave& Cave::Dodecahedron() {
+    static const Cave dodecahedron = Build(CaveSpec());
+    return dodecahedron;
+}
+
+Cave Cave::Build(const CaveSpec& spec) {
+    EdgeList edges;
+    switch (spec.kind) {
+        case CaveKind::Dodecahedron:
+            edges = DodecahedronEdges();
+            return Cave(spec, 20, edges);
+        case CaveKind::TruncatedIcosahedron:
+            edges = TruncatedIcosahedronEdges();
+            return Cave(spec, 60, edges);
+        case CaveKind::Torus:
+        case CaveKind::Grid:
+            if (spec.width * spec.height < kMinRooms)
+                throw invalid_argument("cave too small: " + CaveSpecName(spec));
+            edges = GridEdges(spec.width, spec.height, spec.kind == CaveKind::Torus);
+            return Cave(spec, spec.width * spec.height, edges);
+        case CaveKind::RandomCubic: {
+            if (spec.width < kMinRooms)
+                throw invalid_argument("cave too small: " + CaveSpecName(spec));
+            Rng rng(spec.seed);
+            for (;;) {
+                edges = RandomCubicEdges(spec.width, rng);
+                Cave cave(spec, spec.width, edges);
+                if (IsConnected(spec.width, cave))
+                    return cave;
+            }
+        }
+    }
+    throw invalid_argument("unknown cave kind");
+}
@@ -0,0 +1,78 @@
+/*
+ * Wump.2 - cave topologies
+ *
+ * A Cave is the map of a level: which rooms connect to which. It is kept
+ * in compressed-sparse-row form, every room's tunnels stored back to back
+ * in one array, so a cave can have any number of rooms and each room any
+ * number of tunnels. Caves are immutable once built and shared by every
+ * level played on them.
+ *
+ * Families, as written on the command line (see ParseCaveSpec):
+ *   dodecahedron     the classic 20 rooms, 3 tunnels each
+ *   icosahedron      truncated icosahedron, 60 rooms, 3 tunnels each
+ *   torus:WxH        W*H rooms on a wrapped grid, 4 tunnels each
+ *   grid:WxH         W*H rooms on an open grid, 1 to 4 tunnels
+ *   cubic:N[:SEED]   random connected 3-regular graph on N rooms (N even)
+ *
+ * Caves of up to kMaxDistanceRooms rooms also keep the length of the
+ * shortest way between every two rooms, one byte each, worked out once
+ * when the cave is built; Distance() is then a lookup.
+ */
+
+#ifndef WUMP_CAVE_H
+#define WUMP_CAVE_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class CaveKind {
+    Dodecahedron,
+    TruncatedIcosahedron,
+    Torus,
+    Grid,
+    RandomCubic
+};
+
+struct CaveSpec {
+    CaveKind kind = CaveKind::Dodecahedron;
+    int width  = 0;     // torus/grid width, or rooms for cubic
+    int height = 0;
+    uint64_t seed = 0;  // cubic only
+};
+
+bool ParseCaveSpec(const std::string&, CaveSpec*);
+std::string CaveSpecName(const CaveSpec&);
+
+class Cave {
+private:
+    CaveSpec spec;
+    int numRooms;
+    std::vector<int> offsets;     // room r's tunnels are neighbors[offsets[r] .. offsets[r+1])
+    std::vector<int> neighbors;
+    std::vector<uint8_t> distances;   // room a to room b at distances[a * numRooms + b]
+
+    Cave(const CaveSpec&, int rooms, std::vector<std::pair<int, int>>& edges);
+    void BuildDistances();
+
+public:
+    static const int kMinRooms = 8;   // room 0 plus everything a level places
+    static const int kMaxDistanceRooms = 4096;    // a 16MB table
+    static const int kFar = 255;      // Distance() of rooms further apart, or not connected
+
+    static const Cave& Dodecahedron();
+    static Cave Build(const CaveSpec&);
+
+    const CaveSpec& Spec() const { return spec; }
+    int  NumRooms() const { return numRooms; }
+    int  Degree(int room) const { return offsets[room + 1] - offsets[room]; }
+    const int* Neighbors(int room) const { return neighbors.data() + offsets[room]; }
+    bool IsAdjacent(int roomA, int roomB) const;
+    // tunnels on the shortest way from a to b, at most kFar; only for
+    // caves with HasDistances()
+    bool HasDistances() const { return !distances.empty(); }
+    int  Distance(int roomA, int roomB) const { return distances[size_t(roomA) * numRooms + roomB]; }
+};
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Wump.2 - dialogs with the player as C++20 coroutines
+ *
+ * A Dialog is a coroutine that talks to one player. Where the old code
+ * blocked on cin it does co_await Dialog::Input() and suspends; whoever
+ * has the player's next input hands it over with Resume() and the dialog
+ * runs until it needs more. A dialog can co_await another one (a level
+ * inside a game); input always goes to the innermost one. Nothing blocks
+ * and no thread or stack is kept per player, so one thread can drive any
+ * number of dialogs.
+ *
+ *     Dialog dialog = PlayGame(game);
+ *     dialog.Start();                     // runs to the first Input()
+ *     while (!dialog.Done() && cin >> word)
+ *         dialog.Resume(word);
+ *
+ * Exceptions thrown inside a dialog come out of Start() or Resume().
+ * Frames are recycled per thread, so a dialog started after another one
+ * finished does not allocate.
+ */
+
+#ifndef WUMP_DIALOG_H
+#define WUMP_DIALOG_H
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <string>
+#include <vector>
+
+// Per-thread free lists of coroutine frames, by size in 64-byte steps
+class FramePool {
+private:
+    static const size_t kStep = 64;
+    static const size_t kBuckets = 64;      // frames up to 4 KB are kept
+    std::vector<void*> spare[kBuckets];
+
+public:
+    ~FramePool() {
+        for (std::vector<void*>& list : spare) {
+            for (void* frame : list)
+                ::operator delete(frame);
+        }
+    }
+
+    static FramePool& ThisThread() {
+        thread_local FramePool pool;
+        return pool;
+    }
+
+    void* Get(size_t size) {
+        size_t bucket = (size + kStep - 1) / kStep;
+        if (bucket >= kBuckets)
+            return ::operator new(size);
+        if (spare[bucket].empty())
+            return ::operator new(bucket * kStep);
+        void* frame = spare[bucket].back();
+        spare[bucket].pop_back();
+        return frame;
+    }
+
+    void Put(void* frame, size_t size) {
+        size_t bucket = (size + kStep - 1) / kStep;
+        if (bucket >= kBuckets)
+            ::operator delete(frame);
+        else
+            spare[bucket].push_back(frame);
+    }
+};
+
+class Dialog {
+public:
+    struct promise_type;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    struct promise_type {
+        promise_type* root = this;      // of the outermost dialog
+        Handle active;                  // root only: the dialog waiting for input
+        Handle caller;                  // the dialog that co_awaited this one
+        std::string input;              // root only: what Resume() was given
+        std::exception_ptr error;
+
+        // returns to the caller, if any, when done
+        struct Return {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(Handle done) noexcept {
+                promise_type& p = done.promise();
+                if (!p.caller)
+                    return std::noop_coroutine();
+                p.root->active = p.caller;
+                return p.caller;
+            }
+            void await_resume() noexcept {}
+        };
+
+        Dialog get_return_object() { return Dialog(Handle::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        Return final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { error = std::current_exception(); }
+
+        static void* operator new(size_t size) { return FramePool::ThisThread().Get(size); }
+        static void operator delete(void* frame, size_t size) { FramePool::ThisThread().Put(frame, size); }
+    };
+
+    // co_await Dialog::Input() suspends until Resume() and returns its input
+    struct Input {
+        promise_type* root = nullptr;
+
+        bool await_ready() noexcept { return false; }
+        void await_suspend(Handle waiting) noexcept {
+            root = waiting.promise().root;
+            root->active = waiting;
+        }
+        std::string await_resume() { return root->input; }
+    };
+
+    Dialog() {}
+    Dialog(Dialog&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Dialog& operator=(Dialog&& other) noexcept {
+        if (this != &other) {
+            if (handle)
+                handle.destroy();
+            handle = other.handle;
+            other.handle = nullptr;
+        }
+        return *this;
+    }
+    Dialog(const Dialog&) = delete;
+    Dialog& operator=(const Dialog&) = delete;
+    ~Dialog() {
+        if (handle)
+            handle.destroy();
+    }
+
+    // runs the dialog until it first needs input
+    void Start() {
+        handle.promise().active = handle;
+        Run();
+    }
+
+    // hands the input to the dialog waiting for it and runs until the next
+    void Resume(const std::string& input) {
+        if (Done())
+            return;
+        handle.promise().input = input;
+        Run();
+    }
+
+    bool Done() const { return !handle || handle.done(); }
+
+    // co_await child: runs a nested dialog to the end
+    bool await_ready() noexcept { return false; }
+    Handle await_suspend(Handle parent) noexcept {
+        promise_type& child = handle.promise();
+        child.caller = parent;
+        child.root = parent.promise().root;
+        child.root->active = handle;
+        return handle;
+    }
+    void await_resume() {
+        if (handle.promise().error)
+            std::rethrow_exception(handle.promise().error);
+    }
+
+private:
+    Handle handle;
+
+    explicit Dialog(Handle h) : handle(h) {}
+
+    void Run() {
+        promise_type& root = handle.promise();
+        root.active.resume();
+        if (handle.done() && root.error)
+            std::rethrow_exception(root.error);
+    }
+};
+
+#endif
@@ -0,0 +1,856 @@
+/*
+ * Wump.2 - rules engine, see wump_engine.h
+ */
+
+#include "wump_engine.h"
+#include "wump_metrics.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+using namespace std;
+
+// conx
+Level::Level(int myLev, const Cave& myCave, const LevelTable& myTable) {
+    if (myLev < 0 || myLev >= myTable.NumLevels())
+        throw invalid_argument("no level " + to_string(myLev) + " in the level definitions");
+    cave = &myCave;
+    numRooms = cave->NumRooms();
+    placed = false;
+    minStartDistance = 1;
+    sampler.Reset(*cave, 0, minStartDistance);
+    myLevelNum = myLev;
+    currentRoom = startingPosition = 0;
+    phase = LevelPhase::Over;
+    numEvents = 0;
+    haveWeapon = false;
+    ammo = 0;
+
+    // shared with every other level of the table, never copied
+    myEnemy  = &myTable.GetEnemy(myLevelNum);
+    myWeapon = &myTable.GetWeapon(myLevelNum);
+    myHaz    = &myTable.GetHazard(myLevelNum);
+    myReloc  = &myTable.GetReloc(myLevelNum);
+    myDef    = &myTable.Def(myLevelNum);
+    bool farWarnings = myEnemy->warnRadius > 1 || myHaz->warnRadius > 1 || myReloc->warnRadius > 1;
+    if ((farWarnings || myEnemy->moves != EnemyMove::Random) && !cave->HasDistances())
+        throw invalid_argument("level " + to_string(myLev) + " needs room distances, which a cave of over "
+                               + to_string(Cave::kMaxDistanceRooms) + " rooms does not keep");
+    if (sampler.DeckSize() < NumPlaced())
+        throw invalid_argument("level " + to_string(myLev) + " places " + to_string(NumPlaced())
+                               + " things, more than the cave has rooms for");
+    // bats fly off to a room other than 0, yours, an enemy's or other bats'
+    if (myDef->numRelocs > 0 && myDef->numEnemies + myDef->numRelocs + 2 > numRooms - 1)
+        throw invalid_argument("level " + to_string(myLev) + " leaves its bats no room to fly to");
+
+    // a slot for everything the level places, -1 until Start() deals it
+    rooms.enemyRooms.assign(myDef->numEnemies, -1);
+    rooms.relocRooms.assign(myDef->numRelocs, -1);
+    rooms.hazRooms.assign(myDef->numHazards, -1);
+    rooms.weaponRooms.assign(myDef->numWeapons, -1);
+    enemyStarts.assign(myDef->numEnemies, -1);
+    relocStarts.assign(myDef->numRelocs, -1);
+    weaponTaken.assign(myDef->numWeapons, 0);
+    enemiesLeft = 0;
+    // radii by kind, in the order of the flags
+    const int radii[OccupancyIndex::kKinds] = {myEnemy->warnRadius, myReloc->warnRadius, myHaz->warnRadius, 0};
+    occupancy.Reset(*cave, radii);
+}
+
+int Level::NumPlaced() const {
+    return myDef->numEnemies + myDef->numRelocs + myDef->numHazards + myDef->numWeapons;
+}
+
+// The Place* functions deal rooms from the shuffled deck of every room
+// except the player's start (and the rooms near it, see
+// SetMinStartDistance), so nothing ever shares a room at the start.
+// They only fill in a layout; Start() moves everything there.
+
+// This function will place the relocs throughout the map
+void Level::PlaceRelocs(Rng& stream, LevelLayout& layout) {
+    for (int& room : layout.relocRooms)
+        room = sampler.Deal(stream);
+}
+
+// this function places the hazs throughout the map
+void Level::PlaceHazs(Rng& stream, LevelLayout& layout) {
+    for (int& room : layout.hazRooms)
+        room = sampler.Deal(stream);
+}
+
+// this function randomly places the enemies, each in a room
+void Level::PlaceEnemy(Rng& stream, LevelLayout& layout) {
+    for (int& room : layout.enemyRooms)
+        room = sampler.Deal(stream);
+}
+
+// place the player in room 0
+void Level::PlacePlayer() {
+    startingPosition = 0;
+    currentRoom = Move(0);
+}
+
+// the weapon never starts with the enemy or in a haz
+void Level::PlaceWeapon(Rng& stream, LevelLayout& layout) {
+    for (int& room : layout.weaponRooms)
+        room = sampler.Deal(stream);
+}
+
+// Everything but the player, in the order Start() has always drawn it
+void Level::DealLayout(Rng& stream, LevelLayout& layout) {
+    layout.enemyRooms.resize(myDef->numEnemies);
+    layout.relocRooms.resize(myDef->numRelocs);
+    layout.hazRooms.resize(myDef->numHazards);
+    layout.weaponRooms.resize(myDef->numWeapons);
+    sampler.Shuffle();
+    PlaceEnemy(stream, layout);
+    PlaceRelocs(stream, layout);
+    PlaceHazs(stream, layout);
+    PlaceWeapon(stream, layout);
+}
+
+// The layout Start() would deal from stream; the level is unchanged
+void Level::Preview(const Rng& stream, LevelLayout& layout) {
+    Rng copy = stream;
+    DealLayout(copy, layout);
+}
+
+// This is a  method that checks if the user inputted a valid room to move to or not.
+// The room number has to be a room of the cave, but also must be adjacent to the current room.
+bool Level::IsValidMove(int roomID) {
+    if ((roomID < 0) || \
+        (roomID > numRooms-1) || \
+        (!IsRoomAdjacent(currentRoom, roomID))) {
+        return false;
+    }
+    return true;
+}
+
+// This method returns true if roomB is adjacent to roomA, otherwise returns false.
+// It is a helper method that scans roomA's tunnels in the cave.
+// It will be used throughout the app to check if we can make a valid move.
+bool Level::IsRoomAdjacent(int roomA, int roomB)
+{
+    return cave->IsAdjacent(roomA, roomB);
+}
+
+// The occupancy index follows the enemies, relocs, hazs and weapons around the cave
+void Level::Occupy(int room, int what) {
+    occupancy.Add(room, what);
+}
+
+void Level::Vacate(int room, int what) {
+    occupancy.Remove(room, what);
+}
+
+// Everything in rooms goes into (or out of) the index; killed enemies
+// and weapons taken are not there
+void Level::OccupyAll() {
+    for (int room : rooms.enemyRooms) {
+        if (room >= 0)
+            Occupy(room, WARN_ENEMY);
+    }
+    for (int room : rooms.relocRooms)
+        Occupy(room, WARN_BATS);
+    for (int room : rooms.hazRooms)
+        Occupy(room, WARN_DRAFT);
+    for (size_t i = 0; i < rooms.weaponRooms.size(); i++) {
+        if (!weaponTaken[i])
+            Occupy(rooms.weaponRooms[i], HOLDS_WEAPON);
+    }
+}
+
+void Level::VacateAll() {
+    for (int room : rooms.enemyRooms) {
+        if (room >= 0)
+            Vacate(room, WARN_ENEMY);
+    }
+    for (int room : rooms.relocRooms)
+        Vacate(room, WARN_BATS);
+    for (int room : rooms.hazRooms)
+        Vacate(room, WARN_DRAFT);
+    for (size_t i = 0; i < rooms.weaponRooms.size(); i++) {
+        if (!weaponTaken[i])
+            Vacate(rooms.weaponRooms[i], HOLDS_WEAPON);
+    }
+}
+
+// This method moves the player to a new room and returns the new room.
+int Level::Move(int newRoom)
+{
+    // currently performs no checks on its own
+    return newRoom;
+}
+
+// Seeds the level's own random numbers; the same seed replays the same level
+void Level::Seed(uint64_t seed) {
+    rng.Seed(seed);
+}
+
+// Keeps the enemy, relocs, hazs and weapon at least distance tunnels
+// away from the start room when the level is next started.
+void Level::SetMinStartDistance(int distance) {
+    if (distance == minStartDistance)
+        return;
+    RoomSampler deck;
+    deck.Reset(*cave, 0, distance);
+    if (deck.DeckSize() < NumPlaced())
+        throw invalid_argument("no room for a level " + to_string(distance) + " tunnels from the start");
+    sampler = deck;
+    minStartDistance = distance;
+}
+
+// Puts the level back the way the constructor left it, keeping its
+// memory, the cave and the start distance; Seed() it again to replay.
+void Level::Reset() {
+    if (placed) {
+        VacateAll();
+        placed = false;
+    }
+    sampler.Shuffle();
+    currentRoom = startingPosition = 0;
+    for (vector<int>* slots : {&rooms.enemyRooms, &rooms.relocRooms, &rooms.hazRooms, &rooms.weaponRooms,
+                               &enemyStarts, &relocStarts})
+        fill(slots->begin(), slots->end(), -1);
+    fill(weaponTaken.begin(), weaponTaken.end(), 0);
+    enemiesLeft = 0;
+    result = LevelResult();
+    phase = LevelPhase::Over;
+    numEvents = 0;
+    haveWeapon = false;
+    ammo = 0;
+}
+
+// Record an event for the current Start()/Step()
+void Level::Emit(EventType type, int room, int value) {
+    if (numEvents < kMaxEvents) {
+        events[numEvents].type  = type;
+        events[numEvents].room  = room;
+        events[numEvents].value = value;
+        numEvents++;
+    }
+}
+
+// Inspects the current room, as a loop rather than recursion so a turn
+// runs in constant stack however it unfolds.
+// Each pass checks the room for enemies, a weapon, relocs and hazs, each
+// one lookup in the occupancy index however many the level holds.
+// Relocs drop you in another room and the loop inspects that one; the
+// relocs themselves only fly off once you have landed, last snatch first.
+// Otherwise it ends with a hazard or by describing the room and its warnings.
+void Level::InspectCurrentRoom() {
+    // rooms whose relocs are still to fly off; the drop is never a relocs'
+    // room, so there is one at most, but nothing here depends on that
+    int snatchedFrom[kMaxSnatches];
+    int numSnatches = 0;
+    int numRelocs = int(rooms.relocRooms.size());
+
+    for (;;) {
+        CurrentRoomEnemyRoom();
+        if (phase != LevelPhase::Playing)
+            break;
+
+        int here = occupancy.Holds(currentRoom);
+        if (here & HOLDS_WEAPON) {      // can find weapon then be picked up by relocs, in that order
+            for (size_t i = 0; i < rooms.weaponRooms.size(); i++) {
+                if (rooms.weaponRooms[i] == currentRoom && !weaponTaken[i]) {
+                    weaponTaken[i] = 1;
+                    Vacate(currentRoom, HOLDS_WEAPON);
+                    break;
+                }
+            }
+            haveWeapon = true;
+            ammo += myWeapon->ammo;
+            Emit(EventType::FoundWeapon, currentRoom);
+        }
+        if ((here & WARN_BATS) && numSnatches < kMaxSnatches) {
+            snatchedFrom[numSnatches++] = currentRoom;
+            Emit(EventType::BatSnatched, currentRoom);
+            if (here & WARN_DRAFT)
+                Emit(EventType::BatSaved, currentRoom);
+            // dropped anywhere but room 0 and the bats' rooms
+            if (numRelocs <= 4) {
+                currentRoom = Move(RoomExcept(rng, 1, numRooms, rooms.relocRooms.data(), numRelocs));
+            } else {
+                skipRooms.assign(rooms.relocRooms.begin(), rooms.relocRooms.end());
+                currentRoom = Move(RoomExceptAll(rng, 1, numRooms, skipRooms));
+            }
+            Emit(EventType::BatDropped, currentRoom);
+            Metrics::Count(Counter::BatRelocations);
+            continue;
+        }
+        if (here & WARN_DRAFT) {
+            Emit(EventType::FellInPit, currentRoom);
+            Metrics::Count(Counter::PitDeaths);
+            Died();
+        } else {
+            Emit(EventType::EnteredRoom, currentRoom, WarningsAt(currentRoom));
+        }
+        break;
+    }
+
+    // the bats fly off to a room without an enemy, you or the other bats
+    while (numSnatches > 0) {
+        int roomRelocsLeft = snatchedFrom[--numSnatches];
+        int bats = int(find(rooms.relocRooms.begin(), rooms.relocRooms.end(), roomRelocsLeft)
+                       - rooms.relocRooms.begin());
+        Vacate(roomRelocsLeft, WARN_BATS);
+        // a short list on the stack for the usual few, else the level's own
+        int taken[4];
+        bool few = enemiesLeft + numRelocs <= 4;
+        int numTaken = 0;
+        skipRooms.clear();
+        auto skip = [&](int room) {
+            if (few)
+                taken[numTaken++] = room;
+            else
+                skipRooms.push_back(room);
+        };
+        for (int room : rooms.enemyRooms) {
+            if (room >= 0)
+                skip(room);
+        }
+        skip(currentRoom);
+        for (int i = 0; i < numRelocs; i++) {
+            if (i != bats)
+                skip(rooms.relocRooms[i]);
+        }
+        int to = few ? RoomExcept(rng, 1, numRooms, taken, numTaken) : RoomExceptAll(rng, 1, numRooms, skipRooms);
+        rooms.relocRooms[bats] = to;
+        Occupy(to, WARN_BATS);
+    }
+}
+
+// what can be heard from here, kept by the occupancy index
+int Level::WarningsAt(int room) const {
+    return occupancy.Heard(room);
+}
+
+// PerformAction
+void Level::PerformAction(const Action& action) {
+    int newRoom = action.room;
+    switch (action.type) {
+        case ActionType::Move:
+            // Check if the player picked a valid room id, then simply move there.
+            if (IsValidMove(newRoom)) {
+                Metrics::Count(Counter::Moves);
+                currentRoom = Move(newRoom);
+                InspectCurrentRoom();
+            } else {
+                Emit(EventType::InvalidMove, newRoom);
+            }
+            break;
+        case ActionType::Attack:
+            if (!CanAttack()) {
+                Emit(EventType::CannotAttack);
+            } else if (IsValidMove(newRoom)) {
+                // a valid room id, so attack into that room.
+                Metrics::Count(Counter::Attacks);
+                if (myWeapon->isLimited)
+                    ammo--;
+                if (occupancy.Holds(newRoom) & WARN_ENEMY) {
+                    KillEnemyIn(newRoom);
+                } else {
+                    // every enemy left hears the miss
+                    for (size_t i = 0; i < rooms.enemyRooms.size(); i++) {
+                        if (rooms.enemyRooms[i] >= 0)
+                            MoveStartledEnemy(int(i));
+                    }
+                    if (myWeapon->isLimited) {
+                        Emit(EventType::AmmoLeft, -1, ammo);
+                    }
+                    CurrentRoomEnemyRoom();
+                }
+            } else {
+                Emit(EventType::InvalidAttack, newRoom);
+            }
+            break;
+        case ActionType::Quit:
+            Emit(EventType::QuitLevel);
+            result.died = true; // quit really
+            phase = LevelPhase::Over;
+            break;
+        case ActionType::Replay:
+            // only meaningful after dying
+            break;
+    }
+}
+
+// Kills one enemy in room; the last one killed clears the level
+void Level::KillEnemyIn(int room) {
+    for (int& enemy : rooms.enemyRooms) {
+        if (enemy == room) {
+            Vacate(room, WARN_ENEMY);
+            enemy = -1;
+            break;
+        }
+    }
+    enemiesLeft--;
+    Emit(EventType::KilledEnemy, room);
+    Metrics::Count(Counter::EnemyKills);
+    if (enemiesLeft == 0) {
+        result.killedEnemy = true;
+        phase = LevelPhase::Over;
+    }
+}
+
+// this function moves an enemy to a room that is adjacent to its
+// current position: at random, or away from or toward the player
+void Level::MoveStartledEnemy(int enemy) {
+    int roomNum = rooms.enemyRooms[enemy];
+    Emit(EventType::EnemyStartled, roomNum);
+    if (rng.Chance(myEnemy->pMove)) {    // e.g., always moves if pMove is 1
+        int next;
+        if (myEnemy->moves == EnemyMove::Random) {
+            int rando = rng(cave->Degree(roomNum));
+            next = cave->Neighbors(roomNum)[rando];
+        } else {
+            next = StartledStep(roomNum);
+        }
+        Vacate(roomNum, WARN_ENEMY);
+        rooms.enemyRooms[enemy] = next;
+        Occupy(next, WARN_ENEMY);
+        Emit(EventType::EnemyMoved, next);
+        Metrics::Count(Counter::EnemyMoves);
+    }
+}
+
+// The tunnel out of from leading furthest from (or nearest to) the
+// player, by the cave's distance table; one of any ties at random
+int Level::StartledStep(int from) {
+    const int* nbr = cave->Neighbors(from);
+    int degree = cave->Degree(from);
+    int sign = myEnemy->moves == EnemyMove::Away ? -1 : 1;
+    int best = 0, ties = 0;
+    for (int j = 0; j < degree; j++) {
+        int d = sign * cave->Distance(nbr[j], currentRoom);
+        if (ties == 0 || d < best) {
+            best = d;
+            ties = 1;
+        } else if (d == best) {
+            ties++;
+        }
+    }
+    int pick = ties > 1 ? rng(ties) : 0;
+    for (int j = 0; j < degree; j++) {
+        if (sign * cave->Distance(nbr[j], currentRoom) == best && pick-- == 0)
+            return nbr[j];
+    }
+    return nbr[0];
+}
+
+// When in the same room with an enemy, one fight per enemy there:
+// If have the weapon and hit, it dies.
+// If don't have the weapon or have it and miss, you die.
+void Level::CurrentRoomEnemyRoom() {
+    while (phase == LevelPhase::Playing && (occupancy.Holds(currentRoom) & WARN_ENEMY)) {
+        // hits with probability pToHit; no weapon/no ammo never does
+        if (CanAttack() && rng.Chance(myWeapon->pToHit)) {
+            KillEnemyIn(currentRoom);
+        } else {
+            Emit(EventType::KilledByEnemy, currentRoom);
+            Metrics::Count(Counter::EnemyDeaths);
+            Died();
+        }
+    }
+}
+
+// The player died; the level waits for Replay or Quit
+void Level::Died() {
+    phase = LevelPhase::AwaitingReplay;
+}
+
+// This restarts the level from the beginning: the enemies and relocs go
+// back where they started and the weapons are there to be found again
+void Level::PlayAgain() {
+    ammo = 0; // lose all ammo
+    haveWeapon = false;
+    currentRoom = startingPosition;
+    VacateAll();
+    copy(enemyStarts.begin(), enemyStarts.end(), rooms.enemyRooms.begin());
+    copy(relocStarts.begin(), relocStarts.end(), rooms.relocRooms.begin());
+    fill(weaponTaken.begin(), weaponTaken.end(), 0);
+    enemiesLeft = int(rooms.enemyRooms.size());
+    OccupyAll();
+    phase = LevelPhase::Playing;
+    Emit(EventType::LevelRestarted, currentRoom);
+    Metrics::Count(Counter::Restarts);
+    InspectCurrentRoom();
+}
+
+StepResult Level::Finish() {
+    StepResult step;
+    step.events = events;
+    step.numEvents = numEvents;
+    step.state = State();
+    return step;
+}
+
+// Start() initializes the level and inspects the initial room.
+// The level is then driven with Step() until its phase is Over.
+StepResult Level::Start()
+{
+    numEvents = 0;
+    startRng = rng;
+    Metrics::Count(Counter::Levels);
+
+    // Initialize the level
+    if (placed) {
+        // played before: clear the last layout out of the cave
+        VacateAll();
+    }
+    ammo = 0;
+    haveWeapon = false;
+    DealLayout(rng, rooms);
+    copy(rooms.enemyRooms.begin(), rooms.enemyRooms.end(), enemyStarts.begin());
+    copy(rooms.relocRooms.begin(), rooms.relocRooms.end(), relocStarts.begin());
+    fill(weaponTaken.begin(), weaponTaken.end(), 0);
+    enemiesLeft = int(rooms.enemyRooms.size());
+    PlacePlayer();
+    OccupyAll();
+    placed = true;
+
+    result.climbDown = false;
+    result.climbUp   = false;
+    result.wonGame   = false;
+    result.died      = false;
+    result.killedEnemy = false;
+    phase = LevelPhase::Playing;
+
+    // Inspects the initial room
+    InspectCurrentRoom();
+    return Finish();
+}
+
+// Step() performs one action: a move or attack while playing,
+// Replay or Quit after dying.
+StepResult Level::Step(const Action& action)
+{
+    numEvents = 0;
+    Metrics::Count(Counter::Turns);
+    if (phase == LevelPhase::Playing) {
+        PerformAction(action);
+    } else if (phase == LevelPhase::AwaitingReplay) {
+        if (action.type == ActionType::Replay) {
+            PlayAgain();
+        } else if (action.type == ActionType::Quit) {
+            result.died = true;
+            phase = LevelPhase::Over;
+        }
+    }
+    return Finish();
+}
+
+LevelState Level::State() const {
+    LevelState state;
+    state.room = currentRoom;
+    state.phase = phase;
+    state.haveWeapon = haveWeapon;
+    state.ammo = ammo;
+    state.result = result;
+    return state;
+}
+
+StepResult Level::Look() {
+    numEvents = 0;
+    if (phase == LevelPhase::Playing)
+        Emit(EventType::EnteredRoom, currentRoom, WarningsAt(currentRoom));
+    return Finish();
+}
+
+static_assert(sizeof(LevelSnapshot) == 104, "LevelSnapshot is a file layout");
+static_assert(sizeof(GameSnapshotHeader) == 48, "GameSnapshotHeader is a file layout");
+
+size_t Level::SnapshotSize() const {
+    size_t rooms32 = 2 * enemyStarts.size() + 2 * relocStarts.size() + rooms.hazRooms.size()
+                   + 2 * weaponTaken.size();
+    return sizeof(LevelSnapshot) + rooms32 * sizeof(int32_t);
+}
+
+// Lists are a handful of rooms: copied one int32 at a time, which beats
+// calling memcpy for each
+static void PutRooms(char*& p, const vector<int>& list) {
+    for (int room : list) {
+        int32_t value = room;
+        memcpy(p, &value, sizeof(value));
+        p += sizeof(value);
+    }
+}
+
+static void GetRooms(const char*& p, vector<int>& list) {
+    for (int& room : list) {
+        int32_t value;
+        memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        room = value;
+    }
+}
+
+// Reads a list of things of kind what back, moving in the index only those
+// whose room changed: restoring the same snapshot over and over, as a
+// search does, touches next to nothing
+void Level::RestoreRooms(const char*& p, vector<int>& list, int what) {
+    for (int& room : list) {
+        int32_t value;
+        memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        if (value != room) {
+            if (room >= 0)
+                Vacate(room, what);
+            room = value;
+            if (room >= 0)
+                Occupy(room, what);
+        }
+    }
+}
+
+// Copied through memcpy, so out need not be aligned
+void Level::Save(void* out) const {
+    LevelSnapshot snap;
+    rng.GetState(snap.rng);
+    startRng.GetState(snap.startRng);
+    snap.currentRoom = currentRoom;
+    snap.startingPosition = startingPosition;
+    snap.ammo = ammo;
+    snap.minStartDistance = minStartDistance;
+    snap.numEnemies = int32_t(enemyStarts.size());
+    snap.numRelocs  = int32_t(relocStarts.size());
+    snap.numHazs    = int32_t(rooms.hazRooms.size());
+    snap.numWeapons = int32_t(weaponTaken.size());
+    snap.phase = uint8_t(phase);
+    snap.haveWeapon = haveWeapon;
+    snap.placed = placed;
+    snap.result = uint8_t(result.climbDown | result.climbUp << 1 | result.wonGame << 2 |
+                          result.died << 3 | result.killedEnemy << 4);
+
+    char* p = static_cast<char*>(out);
+    memcpy(p, &snap, sizeof(snap));
+    p += sizeof(snap);
+    PutRooms(p, rooms.enemyRooms);
+    PutRooms(p, enemyStarts);
+    PutRooms(p, rooms.relocRooms);
+    PutRooms(p, relocStarts);
+    PutRooms(p, rooms.hazRooms);
+    PutRooms(p, rooms.weaponRooms);
+    for (uint8_t taken : weaponTaken) {
+        int32_t value = taken;
+        memcpy(p, &value, sizeof(value));
+        p += sizeof(value);
+    }
+}
+
+// This level's counts, rooms in this cave, a known phase, and a layout
+// if it is being played
+bool Level::CanRestore(const void* in) const {
+    LevelSnapshot snap;
+    memcpy(&snap, in, sizeof(snap));
+    if (snap.phase > uint8_t(LevelPhase::Over) || snap.ammo < 0
+        || snap.minStartDistance != minStartDistance)
+        return false;
+    if (snap.numEnemies != int32_t(enemyStarts.size()) || snap.numRelocs != int32_t(relocStarts.size())
+        || snap.numHazs != int32_t(rooms.hazRooms.size()) || snap.numWeapons != int32_t(weaponTaken.size()))
+        return false;
+    auto inCave = [this](int32_t room) { return uint32_t(room) < uint32_t(numRooms); };
+    if (!inCave(snap.currentRoom) || !inCave(snap.startingPosition))
+        return false;
+    if (!snap.placed)
+        return LevelPhase(snap.phase) == LevelPhase::Over;
+
+    // enemies (-1 once killed), then rooms, then weapons taken
+    const char* p = static_cast<const char*>(in) + sizeof(snap);
+    auto next = [&p]() {
+        int32_t value;
+        memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        return value;
+    };
+    int alive = 0;
+    bool fits = true;
+    for (int i = 0; i < snap.numEnemies; i++) {
+        int32_t room = next();
+        alive += room >= 0;
+        fits &= room == -1 || inCave(room);
+    }
+    int numRooms32 = snap.numEnemies + 2 * snap.numRelocs + snap.numHazs + snap.numWeapons;
+    for (int i = 0; i < numRooms32; i++)
+        fits &= inCave(next());
+    for (int i = 0; i < snap.numWeapons; i++)
+        fits &= uint32_t(next()) <= 1;
+    // killed enemies only end the level with the last one
+    return fits && (alive > 0 || LevelPhase(snap.phase) != LevelPhase::Playing);
+}
+
+void Level::Restore(const void* in) {
+    if (!CanRestore(in))
+        throw invalid_argument("snapshot of level " + to_string(myLevelNum) + " does not fit its cave");
+    LevelSnapshot snap;
+    memcpy(&snap, in, sizeof(snap));
+    rng.SetState(snap.rng);
+    startRng.SetState(snap.startRng);
+    currentRoom = snap.currentRoom;
+    startingPosition = snap.startingPosition;
+    ammo = snap.ammo;
+    phase = LevelPhase(snap.phase);
+    haveWeapon = snap.haveWeapon != 0;
+    // the index holds the rooms while placed; only changes are made to it
+    // when both are, see RestoreRooms
+    bool wasPlaced = placed;
+    placed = snap.placed != 0;
+    if (wasPlaced && !placed)
+        VacateAll();
+    result.climbDown   = snap.result & 1;
+    result.climbUp     = snap.result & 2;
+    result.wonGame     = snap.result & 4;
+    result.died        = snap.result & 8;
+    result.killedEnemy = snap.result & 16;
+
+    const char* p = static_cast<const char*>(in) + sizeof(snap);
+    if (wasPlaced && placed) {
+        // weapons can be taken as well as moved; there are few
+        for (size_t i = 0; i < weaponTaken.size(); i++) {
+            if (!weaponTaken[i])
+                Vacate(rooms.weaponRooms[i], HOLDS_WEAPON);
+        }
+        RestoreRooms(p, rooms.enemyRooms, WARN_ENEMY);
+        GetRooms(p, enemyStarts);
+        RestoreRooms(p, rooms.relocRooms, WARN_BATS);
+        GetRooms(p, relocStarts);
+        RestoreRooms(p, rooms.hazRooms, WARN_DRAFT);
+    } else {
+        GetRooms(p, rooms.enemyRooms);
+        GetRooms(p, enemyStarts);
+        GetRooms(p, rooms.relocRooms);
+        GetRooms(p, relocStarts);
+        GetRooms(p, rooms.hazRooms);
+    }
+    GetRooms(p, rooms.weaponRooms);
+    for (uint8_t& taken : weaponTaken) {
+        int32_t value;
+        memcpy(&value, p, sizeof(value));
+        p += sizeof(value);
+        taken = uint8_t(value);
+    }
+    enemiesLeft = 0;
+    for (int room : rooms.enemyRooms)
+        enemiesLeft += room >= 0;
+    if (wasPlaced && placed) {
+        for (size_t i = 0; i < weaponTaken.size(); i++) {
+            if (!weaponTaken[i])
+                Occupy(rooms.weaponRooms[i], HOLDS_WEAPON);
+        }
+    } else if (placed) {
+        OccupyAll();
+    }
+    numEvents = 0;
+}
+
+// conx
+Game::Game(const Cave& cave, const LevelTable& table) {
+    numLevels = table.NumLevels();
+    levels.reserve(numLevels);
+    for (int i=0; i<numLevels; i++)
+        levels.emplace_back(i, cave, table);
+    currentLev = 0;
+}
+
+// Back to the first level with every level as new, without allocating;
+// Seed() it again for the next game
+void Game::Reset() {
+    for (Level& level : levels)
+        level.Reset();
+    currentLev = 0;
+}
+
+// Each level gets its own seed derived from the game's
+void Game::Seed(uint64_t seed) {
+    for (int i=0; i<numLevels; i++)
+        levels[i].Seed(Rng::Mix(seed));
+}
+
+void Game::SetMinStartDistance(int distance) {
+    for (int i=0; i<numLevels; i++)
+        levels[i].SetMinStartDistance(distance);
+}
+
+// Moves the game along after a level ends.
+// Returns true once the player advanced beyond the last level.
+bool Game::RecordResult(const LevelResult& levelResult) {
+    if (levelResult.climbDown) {        // not currently used
+        currentLev++;
+    } else if (levelResult.climbUp) {   // not currently used
+        currentLev--;
+    } else if (levelResult.killedEnemy) {
+        currentLev++;
+    }
+    return currentLev == numLevels;
+}
+
+size_t Game::SnapshotSize() const {
+    size_t size = sizeof(GameSnapshotHeader);
+    for (const Level& level : levels)
+        size += level.SnapshotSize();
+    return size;
+}
+
+// Fixed layout in native byte order, so it can be used straight from a
+// mapped file; copied through memcpy, so out need not be aligned.
+void Game::Save(void* out) const {
+    GameSnapshotHeader header = {};
+    memcpy(header.magic, WUMP_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.byteOrder = WUMP_SNAPSHOT_BYTE_ORDER;
+    header.size = uint32_t(SnapshotSize());
+    header.numLevels = numLevels;
+    header.currentLev = currentLev;
+    const Cave& cave = levels[0].GetCave();
+    header.numRooms = cave.NumRooms();
+    header.caveKind = int32_t(cave.Spec().kind);
+    header.caveWidth = cave.Spec().width;
+    header.caveHeight = cave.Spec().height;
+    header.caveSeed = cave.Spec().seed;
+
+    char* p = static_cast<char*>(out);
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    for (const Level& level : levels) {
+        level.Save(p);
+        p += level.SnapshotSize();
+    }
+}
+
+// Checks everything before changing anything: a snapshot that does not
+// fit leaves the game as it was.
+void Game::Restore(const void* in, size_t size) {
+    GameSnapshotHeader header;
+    if (size < sizeof(header))
+        throw invalid_argument("snapshot is too short");
+    memcpy(&header, in, sizeof(header));
+    if (memcmp(header.magic, WUMP_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+        throw invalid_argument("not a snapshot");
+    if (header.byteOrder != WUMP_SNAPSHOT_BYTE_ORDER)
+        throw invalid_argument("snapshot was written with the other byte order");
+    if (header.numLevels != numLevels)
+        throw invalid_argument("snapshot has " + to_string(header.numLevels) + " levels, the game "
+                               + to_string(numLevels));
+    if (header.size != SnapshotSize() || size < SnapshotSize())
+        throw invalid_argument("snapshot was saved with other level definitions");
+    const CaveSpec& spec = levels[0].GetCave().Spec();
+    if (header.numRooms != levels[0].NumRooms() || header.caveKind != int32_t(spec.kind)
+        || header.caveWidth != spec.width || header.caveHeight != spec.height
+        || header.caveSeed != spec.seed)
+        throw invalid_argument("snapshot was played on another cave");
+    if (header.currentLev < 0 || header.currentLev >= numLevels)
+        throw invalid_argument("snapshot is damaged");
+
+    const char* first = static_cast<const char*>(in) + sizeof(header);
+    const char* p = first;
+    for (int i = 0; i < numLevels; i++) {
+        if (!levels[i].CanRestore(p))
+            throw invalid_argument("snapshot of level " + to_string(i) + " does not fit");
+        p += levels[i].SnapshotSize();
+    }
+    p = first;
+    for (int i = 0; i < numLevels; i++) {
+        levels[i].Restore(p);
+        p += levels[i].SnapshotSize();
+    }
+    currentLev = header.currentLev;
+}
@@ -0,0 +1,278 @@
+/*
+ * Wump.2 - rules engine
+ *
+ * Everything in here is headless: no cin, no cout, no CatFile. A Level is
+ * driven with Start() and then one Step(Action) per player decision. Each
+ * call returns the events that happened and the resulting state; the
+ * console front end (Wump.2.cpp) and the simulator (wump_sim.cpp) decide
+ * what to do with them.
+ */
+
+#ifndef WUMP_ENGINE_H
+#define WUMP_ENGINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "wump_cave.h"
+#include "wump_levels.h"
+#include "wump_occupancy.h"
+#include "wump_place.h"
+#include "wump_rng.h"
+
+// LevelResult passed from Level to Game
+struct LevelResult {
+    bool climbDown = false;
+    bool climbUp   = false;
+    bool wonGame   = false;
+    bool died      = false;
+    bool killedEnemy = false;
+};
+
+// What the player asks the level to do
+enum class ActionType {
+    Move,       // move to room
+    Attack,     // attack into room
+    Quit,       // leave the level (also "no" when offered a replay)
+    Replay      // replay the level after dying
+};
+
+struct Action {
+    ActionType type;
+    int room;
+};
+
+// What happened as a result of an action
+enum class EventType {
+    EnteredRoom,        // room = where you are, value = warning flags
+    FoundWeapon,
+    BatSnatched,        // room = room the bats took you from
+    BatSaved,           // the bats' room also had a pit
+    BatDropped,         // room = where the bats left you
+    FellInPit,
+    KilledEnemy,
+    KilledByEnemy,
+    LevelRestarted,
+    InvalidMove,
+    InvalidAttack,
+    CannotAttack,
+    EnemyStartled,
+    EnemyMoved,
+    AmmoLeft,           // value = quantity left
+    QuitLevel
+};
+
+// warning flags carried by EnteredRoom; also what a room holds in the
+// OccupancyIndex (wump_occupancy.h), which works out the warnings
+const int WARN_ENEMY = 1;
+const int WARN_BATS  = 2;
+const int WARN_DRAFT = 4;
+
+struct Event {
+    EventType type;
+    int room;
+    int value;
+};
+
+enum class LevelPhase {
+    Playing,
+    AwaitingReplay,     // died; Replay or Quit
+    Over                // killed the enemy or quit
+};
+
+struct LevelState {
+    int room;
+    LevelPhase phase;
+    bool haveWeapon;
+    int  ammo;
+    LevelResult result;
+};
+
+// events are only valid until the next Start()/Step() on the same level
+struct StepResult {
+    const Event* events;
+    int numEvents;
+    LevelState state;
+};
+
+// where everything is, as many of each as the level's LevelDef says; for
+// debugging and tools, not for agents. A killed enemy's room is -1.
+struct LevelLayout {
+    std::vector<int> enemyRooms;
+    std::vector<int> relocRooms;
+    std::vector<int> hazRooms;
+    std::vector<int> weaponRooms;
+};
+
+// The fixed part of a level's state: what Save() writes first and
+// Restore() reads back. The rooms follow it as int32s, in the order
+//
+//     enemies, enemy starts, relocs, reloc starts, hazs, weapons, weapons taken
+//
+// with as many of each as the counts say (weapons taken are 0 or 1), so a
+// level's snapshot is a fixed size for its LevelDef. Occupancy is rebuilt
+// from the rooms and the sampler is shuffled by every Start(), so neither
+// is stored. See wump_snapshot.h.
+struct LevelSnapshot {
+    uint64_t rng[4];
+    uint64_t startRng[4];
+    int32_t  currentRoom, startingPosition;
+    int32_t  ammo;
+    int32_t  minStartDistance;
+    int32_t  numEnemies, numRelocs, numHazs, numWeapons;
+    uint8_t  phase;         // LevelPhase
+    uint8_t  haveWeapon;
+    uint8_t  placed;
+    uint8_t  result;        // LevelResult bits, as in the turn log
+};
+
+// What comes before the levels' snapshots in a game's
+struct GameSnapshotHeader {
+    char     magic[8];      // WUMP_SNAPSHOT_MAGIC
+    uint32_t byteOrder;     // WUMP_SNAPSHOT_BYTE_ORDER as the writer stored it
+    uint32_t size;          // of the whole snapshot, header included
+    int32_t  numLevels;
+    int32_t  currentLev;
+    int32_t  numRooms;
+    int32_t  caveKind;      // the CaveSpec of the cave it was played on
+    int32_t  caveWidth, caveHeight;
+    uint64_t caveSeed;
+};
+
+const char WUMP_SNAPSHOT_MAGIC[8] = {'W', 'U', 'M', 'P', 'S', 'N', 'P', '2'};
+const uint32_t WUMP_SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+class Level {
+private:
+    static const int kMaxEvents = 32;
+    static const int kMaxSnatches = 4;
+
+    int numRooms;
+    int currentRoom, startingPosition;
+    LevelLayout rooms;                  // where everything is now
+    std::vector<int> enemyStarts, relocStarts;  // for PlayAgain()
+    std::vector<uint8_t> weaponTaken;   // per weapon cache, until PlayAgain()
+    int enemiesLeft;
+    std::vector<int> skipRooms;         // rooms a crowded level's bats avoid, memory reused
+    const Cave* cave;
+    OccupancyIndex occupancy;           // what is in and heard in each room
+    bool placed;                        // occupancy holds a layout from Start()
+    RoomSampler sampler;                // deals the rooms for the Place* functions
+    int minStartDistance;
+    Rng rng;                            // this level's random numbers
+    Rng startRng;                       // rng as it was at the last Start()
+    int myLevelNum;
+    LevelResult result; // climb down, up, win, die, kill enemy
+    LevelPhase phase;
+    bool haveWeapon;
+    int  ammo;                          // only counts down for limited weapons
+    const Weapon* myWeapon;             // from the LevelTable
+    const Enemy*  myEnemy;
+    const Hazard* myHaz;
+    const Relocator* myReloc;
+    const LevelDef*  myDef;             // how many of each to place
+
+    // events of the current Start()/Step()
+    Event events[kMaxEvents];
+    int numEvents;
+
+    void PlaceHazs(Rng&, LevelLayout&);
+    void PlaceRelocs(Rng&, LevelLayout&);
+    void PlaceEnemy(Rng&, LevelLayout&);
+    void PlacePlayer();
+    void PlaceWeapon(Rng&, LevelLayout&);
+    void DealLayout(Rng&, LevelLayout&);
+    bool IsValidMove(int);
+    bool IsRoomAdjacent(int, int);
+    void Occupy(int room, int what);
+    void Vacate(int room, int what);
+    void OccupyAll();
+    void VacateAll();
+    void RestoreRooms(const char*& p, std::vector<int>& list, int what);
+    int  Move(int);
+    void InspectCurrentRoom();
+    void PerformAction(const Action&);
+    void MoveStartledEnemy(int enemy);
+    void KillEnemyIn(int room);
+    void PlayAgain();
+    void Died();
+    void CurrentRoomEnemyRoom();
+    int  WarningsAt(int room) const;
+    int  StartledStep(int from);
+    void Emit(EventType, int room = -1, int value = 0);
+    StepResult Finish();
+
+public:
+    Level(int, const Cave& = Cave::Dodecahedron(), const LevelTable& = LevelTable::Default());
+    void Reset();
+    int  LevelNum() const { return myLevelNum; }
+    StepResult Start();
+    StepResult Step(const Action&);
+    LevelState State() const;
+    // EnteredRoom for the room you are in, changing nothing; e.g. after Restore()
+    StepResult Look();
+    const LevelResult& Result() const { return result; }
+    LevelPhase Phase() const { return phase; }
+    // have the weapon and, if it needs ammo, some ammo
+    bool CanAttack() const { return haveWeapon && (!myWeapon->isLimited || ammo > 0); }
+    const LevelLayout& Layout() const { return rooms; }
+    // where Start() would put everything if it were called with stream
+    // as the level's generator, into layout (its memory reused); only the
+    // scratch sampler changes
+    void Preview(const Rng& stream, LevelLayout& layout);
+    int  NumPlaced() const;
+    void Seed(uint64_t);
+    void SetRng(const Rng& stream) { rng = stream; }
+    const Rng& GetRng() const { return rng; }
+    const Rng& StartRng() const { return startRng; }
+    void SetMinStartDistance(int);
+    int  MinStartDistance() const { return minStartDistance; }
+
+    // the whole state in microseconds, without allocating: a LevelSnapshot
+    // and then the rooms, SnapshotSize() bytes; restoring a copy into
+    // another level of the same cave and definition forks the game there
+    size_t SnapshotSize() const;
+    void Save(void* out) const;
+    bool CanRestore(const void* in) const;
+    void Restore(const void* in);           // invalid_argument unless CanRestore
+
+    const Cave& GetCave() const { return *cave; }
+    int NumRooms() const { return numRooms; }
+    int NumNeighbors(int room) const { return cave->Degree(room); }
+    const int* Neighbors(int room) const { return cave->Neighbors(room); }
+
+    const Enemy&     GetEnemy()  const { return *myEnemy; }
+    const Weapon&    GetWeapon() const { return *myWeapon; }
+    const Hazard&    GetHazard() const { return *myHaz; }
+    const Relocator& GetReloc()  const { return *myReloc; }
+    const LevelDef&  GetDef()    const { return *myDef; }
+};
+
+// A game owns its levels by value; all of its memory is allocated by the
+// constructor, and Reset() reuses it for the next game.
+class Game {
+private:
+    std::vector<Level> levels;
+    int numLevels;
+    int currentLev;
+
+public:
+    // one level per [level] of the table
+    Game(const Cave& = Cave::Dodecahedron(), const LevelTable& = LevelTable::Default());
+    void   Reset();
+    int    NumLevels() const { return numLevels; }
+    int    CurrentLevelNum() const { return currentLev; }
+    Level& CurrentLevel() { return levels[currentLev]; }
+    void   SelectLevel(int lev) { currentLev = lev; }
+    void   Seed(uint64_t);
+    void   SetMinStartDistance(int);
+    bool   RecordResult(const LevelResult&);
+
+    // a GameSnapshotHeader and then each level's snapshot in turn
+    size_t SnapshotSize() const;
+    void   Save(void* out) const;                   // SnapshotSize() bytes
+    void   Restore(const void* in, size_t size);    // invalid_argument if it does not fit
+};
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ * Wump.2 - validated level layouts, see wump_levelgen.h
+ */
+
+#include "wump_levelgen.h"
+#include <climits>
+#include <stdexcept>
+using namespace std;
+
+// conx
+LevelGenerator::LevelGenerator(const Cave& c, const LevelRules& r) : cave(&c), rules(r) {
+    int numRooms = cave->NumRooms();
+    startDistance.assign(numRooms, INT_MAX);
+    queue.reserve(numRooms);
+    blocked.assign(numRooms, 0);
+    startDistance[0] = 0;
+    queue.push_back(0);
+    for (size_t head = 0; head < queue.size(); head++) {
+        int room = queue[head];
+        for (int j = 0; j < cave->Degree(room); j++) {
+            int nbr = cave->Neighbors(room)[j];
+            if (startDistance[nbr] == INT_MAX) {
+                startDistance[nbr] = startDistance[room] + 1;
+                queue.push_back(nbr);
+            }
+        }
+    }
+}
+
+// One search from the start through every room without a pit, bats or
+// an enemy; only the rooms it touched are cleared afterwards.
+bool LevelGenerator::Passes(const LevelLayout& layout) {
+    for (int enemy : layout.enemyRooms) {
+        if (startDistance[enemy] < rules.minEnemyDistance)
+            return false;
+    }
+    if (!rules.safeWeapon)
+        return true;
+
+    const vector<int>* hazards[3] = {&layout.hazRooms, &layout.relocRooms, &layout.enemyRooms};
+    for (const vector<int>* rooms : hazards) {
+        for (int room : *rooms)
+            blocked[room] = 1;
+    }
+    queue.clear();
+    queue.push_back(0);
+    blocked[0] = 2;
+    for (size_t head = 0; head < queue.size(); head++) {
+        int room = queue[head];
+        for (int j = 0; j < cave->Degree(room); j++) {
+            int nbr = cave->Neighbors(room)[j];
+            if (blocked[nbr] == 0) {
+                blocked[nbr] = 2;
+                queue.push_back(nbr);
+            }
+        }
+    }
+    // some weapon, and a shot at every enemy
+    bool passes = false;
+    for (int weapon : layout.weaponRooms) {
+        if (blocked[weapon] == 2)
+            passes = true;
+    }
+    for (size_t i = 0; passes && i < layout.enemyRooms.size(); i++) {
+        int enemy = layout.enemyRooms[i];
+        passes = false;
+        for (int j = 0; j < cave->Degree(enemy); j++) {
+            if (blocked[cave->Neighbors(enemy)[j]] == 2)
+                passes = true;
+        }
+    }
+    for (int room : queue)
+        blocked[room] = 0;
+    for (const vector<int>* rooms : hazards) {
+        for (int room : *rooms)
+            blocked[room] = 0;
+    }
+    return passes;
+}
+
+Rng LevelGenerator::Find(Level& level, const Rng& stream) {
+    Rng candidate = stream;
+    for (int i = 0; i < kMaxTries; i++) {
+        level.Preview(candidate, layout);
+        if (Passes(layout))
+            return candidate;
+        candidate.Seed(candidate.Next());
+    }
+    throw runtime_error("no layout of level " + to_string(level.LevelNum()) + " passes the level rules");
+}
+
+// conx
+LevelPool::LevelPool(const Cave& c, const LevelTable& t, const LevelRules& r, int minDistance,
+                     size_t count, int threads, uint64_t seed)
+    : cave(c), table(t), rules(r), minStartDistance(minDistance), perLevel(count < 1 ? 1 : count),
+      ready(t.NumLevels()), failed(t.NumLevels()), stopping(false), generated(0) {
+    Rng streams(seed);
+    // one of each level here, so impossible rules fail now rather than in Pop()
+    LevelGenerator generator(cave, rules);
+    for (int lev = 0; lev < table.NumLevels(); lev++) {
+        Level level(lev, cave, table);
+        level.SetMinStartDistance(minStartDistance);
+        ready[lev].push_back(generator.Find(level, streams.Split()));
+        generated++;
+    }
+    if (threads < 1)
+        threads = int(thread::hardware_concurrency());
+    if (threads < 1)
+        threads = 1;
+    for (int i = 0; i < threads; i++)
+        workers.emplace_back(&LevelPool::Work, this, streams.Split());
+}
+
+LevelPool::~LevelPool() {
+    {
+        lock_guard<mutex> hold(lock);
+        stopping = true;
+    }
+    taken.notify_all();
+    for (thread& worker : workers)
+        worker.join();
+}
+
+// Tops up whichever level has the fewest ready, until all are full again;
+// a level Find() gives up on is left for Pop() to report
+void LevelPool::Work(Rng stream) {
+    LevelGenerator generator(cave, rules);
+    vector<Level> levels;
+    for (int lev = 0; lev < table.NumLevels(); lev++) {
+        levels.emplace_back(lev, cave, table);
+        levels.back().SetMinStartDistance(minStartDistance);
+    }
+    unique_lock<mutex> hold(lock);
+    for (;;) {
+        int lev = -1;
+        taken.wait(hold, [&]() {
+            lev = -1;
+            for (int i = 0; i < int(ready.size()); i++) {
+                if (failed[i].empty() && ready[i].size() < perLevel
+                    && (lev < 0 || ready[i].size() < ready[lev].size()))
+                    lev = i;
+            }
+            return stopping || lev >= 0;
+        });
+        if (stopping)
+            return;
+        hold.unlock();
+        try {
+            Rng found = generator.Find(levels[lev], Rng(stream.Next()));
+            hold.lock();
+            ready[lev].push_back(found);
+            generated++;
+        } catch (const exception& e) {
+            hold.lock();
+            failed[lev] = e.what();
+        }
+        filled.notify_all();
+    }
+}
+
+Rng LevelPool::Pop(int lev) {
+    unique_lock<mutex> hold(lock);
+    filled.wait(hold, [&]() { return !ready[lev].empty() || !failed[lev].empty(); });
+    if (ready[lev].empty())
+        throw runtime_error(failed[lev]);
+    Rng found = ready[lev].front();
+    ready[lev].pop_front();
+    // the workers top up from half full, rather than waking for every pop
+    if (ready[lev].size() == perLevel / 2)
+        taken.notify_all();
+    return found;
+}
+
+long LevelPool::Generated() {
+    lock_guard<mutex> hold(lock);
+    return generated;
+}
@@ -0,0 +1,102 @@
+/*
+ * Wump.2 - validated level layouts
+ *
+ * Start() deals a level at random and checks nothing, so a pit or the
+ * bats can sit on every way to the weapon. A LevelGenerator looks ahead
+ * at the layouts Start() would deal (Level::Preview) and moves the level's
+ * generator on to one that passes LevelRules:
+ *
+ *   - a weapon can be reached from the start without entering a pit,
+ *     bats or an enemy (--safe-levels)
+ *   - a room next to every enemy can be reached the same way, so each
+ *     can be shot at once armed
+ *   - every enemy is at least minEnemyDistance tunnels from the start
+ *
+ * Checking is one breadth-first search over the cave, in memory allocated
+ * once. The chosen state is the level's own generator moved on, so the
+ * level still plays, records and replays like any other; with the same
+ * seed the same layouts come out.
+ *
+ * A LevelPool does the searching ahead of time on worker threads and
+ * keeps a number of passing states per level ready, so starting a level
+ * is a pop. Pooled levels depend on which thread found them first, not on
+ * a seed; use the generator where games must come out the same each run.
+ */
+
+#ifndef WUMP_LEVELGEN_H
+#define WUMP_LEVELGEN_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "wump_engine.h"
+
+struct LevelRules {
+    bool safeWeapon = false;        // the weapon and a shot at the enemy are reachable
+    int  minEnemyDistance = 0;      // tunnels from the start to each enemy
+};
+
+class LevelGenerator {
+private:
+    static const int kMaxTries = 100000;
+
+    const Cave* cave;
+    LevelRules rules;
+    std::vector<int> startDistance;     // from room 0, where every level starts
+    std::vector<int> queue;
+    std::vector<uint8_t> blocked;       // 1 = pit, bats or enemy; 2 = also reached
+    LevelLayout layout;                 // Find()'s previews, memory reused
+
+public:
+    LevelGenerator(const Cave&, const LevelRules&);
+    const LevelRules& Rules() const { return rules; }
+
+    bool Passes(const LevelLayout&);
+    // the first state from stream on (stream itself if it passes, then
+    // states reseeded from each one's next draw) whose layout passes;
+    // runtime_error if none does in kMaxTries
+    Rng Find(Level&, const Rng& stream);
+    // moves the level's generator on to Find(level, its generator)
+    void Prepare(Level& level) { level.SetRng(Find(level, level.GetRng())); }
+};
+
+class LevelPool {
+private:
+    const Cave& cave;
+    const LevelTable& table;
+    LevelRules rules;
+    int minStartDistance;
+    size_t perLevel;
+
+    std::mutex lock;
+    std::condition_variable filled;     // a state was added
+    std::condition_variable taken;      // a level fell to half full, or stopping
+    std::vector<std::deque<Rng>> ready; // per level
+    std::vector<std::string> failed;    // per level, why Find() gave up on it
+    bool stopping;
+    std::vector<std::thread> workers;
+    long generated;
+
+    void Work(Rng stream);
+
+public:
+    // threads 0 means one per core; throws, like Find(), if the rules
+    // cannot be met on this cave
+    LevelPool(const Cave&, const LevelTable&, const LevelRules&, int minStartDistance,
+              size_t perLevel, int threads, uint64_t seed);
+    ~LevelPool();
+    LevelPool(const LevelPool&) = delete;
+    LevelPool& operator=(const LevelPool&) = delete;
+
+    // a passing state for level lev, waiting for one if none is ready;
+    // runtime_error once none is left and a worker's Find() gave up on it
+    Rng Pop(int lev);
+    void Prepare(Level& level) { level.SetRng(Pop(level.LevelNum())); }
+    long Generated();
+};
+
+#endif
@@ -0,0 +1,412 @@
+/*
+ * Wump.2 - level definitions, see wump_levels.h
+ */
+
+#include "wump_levels.h"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+using namespace std;
+
+// wump_levels.txt, built in; keep the two the same
+static const char* DEFAULT_LEVELS = R"LEVELS(# Wump.2 level definitions
+#
+# [enemy ID], [weapon ID], [hazard ID] and [reloc ID] sections define the
+# things a level can have; each [level] section then picks one of each by
+# ID, in the order the levels are played. There can be any number of
+# levels. Lines are "key = value"; a value runs to the end of the line,
+# \n in it starts a new line, and double quotes around it keep spaces at
+# either end. Images are asset names separated by spaces.
+# Blank lines and lines starting with # are ignored.
+#
+# Warnings are heard from the next room by default; warnRadius = K on an
+# enemy, hazard or reloc is heard up to K tunnels away instead. A startled
+# enemy runs down a random tunnel unless it has moves = away (the one
+# leading furthest from the player) or moves = toward (nearest). Both need
+# a cave small enough to keep its distance table (see wump_cave.h).
+#
+# A [level] places one enemy, two hazards, two relocs and one weapon unless
+# it says otherwise with numEnemies, numHazards, numRelocs and numWeapons.
+# Every enemy has to be killed to clear the level, and each weapon found
+# adds its ammo; the cave needs a room for each of them.
+#
+# Wump.2, wump_sim, wump_replay and wump_solve read a file like this one
+# with --levels FILE; without it they use a built-in copy of this file.
+
+[enemy spider]
+name = Spider
+warningMsg = You hear a light tap-tap coming towards you...
+killedItMsg = SHLACHING.. Thump! \nGood shot! You killed the Spider!
+killedYouMsg = The Spider bit you and quickly wrapped you in a cocoon web!
+pMove = 1
+killedItImages = spider.rotate
+killedYouImages = spider
+
+[enemy snake]
+name = Snake
+warningMsg = You hear something slither on the ground...
+killedItMsg = KA-POW.. Slice! \nNice! You killed the Snake!
+killedYouMsg = The Snake bit you! You've been injected with venom!
+pMove = 1
+killedItImages = snake.rotate
+killedYouImages = snake
+
+[enemy frost.mage]
+name = Frost Mage
+warningMsg = You feel a sudden chill...
+killedItMsg = SS-TCCAAH.. Pow! \nVictory! You killed the Frost Mage!
+killedYouMsg = The Frost Mage cast a spell that instantaneously froze you to the core!
+pMove = 1
+killedItImages = frost.mage explosion
+killedYouImages = frost.mage
+
+[enemy wumpus]
+name = Wumpus
+warningMsg = You smell a horrid stench...
+killedItMsg = ARGH.. Splat! \nCongratulations! You killed the Wumpus!
+killedYouMsg = The Wumpus ate you!
+pMove = 0.75
+killedItImages = wump.rotate
+killedYouImages = wump.partial wump.blur wump
+
+[weapon bow]
+name = Bow
+isLimited = 1
+ammo = 2
+pToHit = 1
+foundMsg = You found two arrows!
+foundImages = arrow bow
+attackImages = arrow
+
+[weapon spade]
+name = Spade
+pToHit = 0.75
+foundMsg = You found the spade!
+foundImages = spade
+attackImages = spade
+
+[weapon club]
+name = Club
+pToHit = 1
+foundMsg = You found the club!
+foundImages = club
+attackImages = club
+
+[weapon sword]
+name = Sword
+pToHit = 0.5
+foundMsg = You found the sword!
+foundImages = sword
+attackImages = sword
+
+[hazard pit]
+nearMsg = You feel a draft...
+killedYouMsg = @#$*! You fell in a pit!
+images = pit
+
+[reloc bats]
+nearMsg = Bats nearby...
+savedMsg = Luckily, the bats saved you from a hazard!
+movedMsg = "The bats moved you to room "
+snatchedMsg = Snatched by superbats!
+images = bat
+
+[level]
+enemy = spider
+weapon = bow
+hazard = pit
+reloc = bats
+
+[level]
+enemy = snake
+weapon = spade
+hazard = pit
+reloc = bats
+
+[level]
+enemy = frost.mage
+weapon = club
+hazard = pit
+reloc = bats
+
+[level]
+enemy = wumpus
+weapon = sword
+hazard = pit
+reloc = bats
+)LEVELS";
+
+static string Trim(const string& s) {
+    size_t begin = s.find_first_not_of(" \t\r");
+    if (begin == string::npos)
+        return "";
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+// "\n" in a value starts a new line, "\\" is a backslash
+static string Unescape(const string& s) {
+    string out;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '\\' && i + 1 < s.size() && (s[i + 1] == 'n' || s[i + 1] == '\\')) {
+            out += s[i + 1] == 'n' ? '\n' : '\\';
+            i++;
+        } else {
+            out += s[i];
+        }
+    }
+    return out;
+}
+
+static vector<string> Words(const string& s) {
+    vector<string> words;
+    istringstream in(s);
+    string word;
+    while (in >> word)
+        words.push_back(word);
+    return words;
+}
+
+template <class T>
+static int FindId(const vector<T>& table, const string& id) {
+    for (size_t i = 0; i < table.size(); i++) {
+        if (table[i].id == id)
+            return int(i);
+    }
+    return -1;
+}
+
+namespace {
+// reads a definition file line by line into a LevelTable
+class Parser {
+private:
+    int lineNum = 0;
+    enum Section { NONE, ENEMY, WEAPON, HAZARD, RELOC, LEVEL } section = NONE;
+    // levels name their parts by id; resolved once everything is read
+    struct LevelIds {
+        int line;
+        string enemy, weapon, hazard, reloc;
+        LevelDef counts;
+    };
+    vector<LevelIds> levelIds;
+
+    [[noreturn]] void Fail(const string& what) const {
+        throw invalid_argument("level definitions line " + to_string(lineNum) + ": " + what);
+    }
+    float Chance(const string& value) const {
+        char* end;
+        float p = strtof(value.c_str(), &end);
+        if (end == value.c_str() || *end || p < 0 || p > 1)
+            Fail("expected a chance from 0 to 1, got \"" + value + "\"");
+        return p;
+    }
+    // warnings reach at least the next room and at most 254 tunnels
+    int Radius(const string& value) const {
+        int n = Count(value);
+        if (n < 1 || n > 254)
+            Fail("expected a warning radius from 1 to 254, got \"" + value + "\"");
+        return n;
+    }
+    // how many of a thing a level places; the index counts up to 65535
+    int Placed(const string& value, int least) const {
+        int n = Count(value);
+        if (n < least || n > 65535)
+            Fail("expected a count from " + to_string(least) + " to 65535, got \"" + value + "\"");
+        return n;
+    }
+    EnemyMove Moves(const string& value) const {
+        if (value == "random") return EnemyMove::Random;
+        if (value == "away")   return EnemyMove::Away;
+        if (value == "toward") return EnemyMove::Toward;
+        Fail("expected random, away or toward, got \"" + value + "\"");
+    }
+    int Count(const string& value) const {
+        char* end;
+        long n = strtol(value.c_str(), &end, 10);
+        if (end == value.c_str() || *end || n < 0)
+            Fail("expected a count, got \"" + value + "\"");
+        return int(n);
+    }
+    template <class T>
+    void Begin(vector<T>& table, Section kind, const string& id) {
+        if (id.empty())
+            Fail("section needs an id");
+        if (FindId(table, id) >= 0)
+            Fail("\"" + id + "\" is defined twice");
+        table.emplace_back();
+        table.back().id = id;
+        section = kind;
+    }
+    void SetEnemy(Enemy&, const string& key, const string& value);
+    void SetWeapon(Weapon&, const string& key, const string& value);
+    void SetHazard(Hazard&, const string& key, const string& value);
+    void SetReloc(Relocator&, const string& key, const string& value);
+    void SetLevel(LevelIds&, const string& key, const string& value);
+
+public:
+    vector<Enemy> enemies;
+    vector<Weapon> weapons;
+    vector<Hazard> hazards;
+    vector<Relocator> relocs;
+    vector<LevelDef> levels;
+
+    void Line(const string& line);
+    void Finish();
+};
+}
+
+void Parser::SetEnemy(Enemy& enemy, const string& key, const string& value) {
+    if (key == "name")                 enemy.name = value;
+    else if (key == "warningMsg")      enemy.warningMsg = value;
+    else if (key == "killedItMsg")     enemy.killedItMsg = value;
+    else if (key == "killedYouMsg")    enemy.killedYouMsg = value;
+    else if (key == "pMove")           enemy.pMove = Chance(value);
+    else if (key == "moves")           enemy.moves = Moves(value);
+    else if (key == "warnRadius")      enemy.warnRadius = Radius(value);
+    else if (key == "killedItImages")  enemy.killedItImages = Words(value);
+    else if (key == "killedYouImages") enemy.killedYouImages = Words(value);
+    else Fail("unknown enemy key \"" + key + "\"");
+}
+
+void Parser::SetWeapon(Weapon& weapon, const string& key, const string& value) {
+    if (key == "name")              weapon.name = value;
+    else if (key == "isLimited")    weapon.isLimited = Count(value) != 0;
+    else if (key == "ammo")         weapon.ammo = Count(value);
+    else if (key == "pToHit")       weapon.pToHit = Chance(value);
+    else if (key == "foundMsg")     weapon.foundMsg = value;
+    else if (key == "foundImages")  weapon.foundImages = Words(value);
+    else if (key == "attackImages") weapon.attackImages = Words(value);
+    else Fail("unknown weapon key \"" + key + "\"");
+}
+
+void Parser::SetHazard(Hazard& hazard, const string& key, const string& value) {
+    if (key == "nearMsg")           hazard.nearMsg = value;
+    else if (key == "killedYouMsg") hazard.killedYouMsg = value;
+    else if (key == "warnRadius")   hazard.warnRadius = Radius(value);
+    else if (key == "images")       hazard.images = Words(value);
+    else Fail("unknown hazard key \"" + key + "\"");
+}
+
+void Parser::SetReloc(Relocator& reloc, const string& key, const string& value) {
+    if (key == "nearMsg")          reloc.nearMsg = value;
+    else if (key == "savedMsg")    reloc.savedMsg = value;
+    else if (key == "movedMsg")    reloc.movedMsg = value;
+    else if (key == "snatchedMsg") reloc.snatchedMsg = value;
+    else if (key == "warnRadius")  reloc.warnRadius = Radius(value);
+    else if (key == "images")      reloc.images = Words(value);
+    else Fail("unknown reloc key \"" + key + "\"");
+}
+
+void Parser::SetLevel(LevelIds& level, const string& key, const string& value) {
+    if (key == "enemy")       level.enemy = value;
+    else if (key == "weapon") level.weapon = value;
+    else if (key == "hazard") level.hazard = value;
+    else if (key == "reloc")  level.reloc = value;
+    else if (key == "numEnemies") level.counts.numEnemies = Placed(value, 1);
+    else if (key == "numWeapons") level.counts.numWeapons = Placed(value, 1);
+    else if (key == "numHazards") level.counts.numHazards = Placed(value, 0);
+    else if (key == "numRelocs")  level.counts.numRelocs = Placed(value, 0);
+    else Fail("unknown level key \"" + key + "\"");
+}
+
+void Parser::Line(const string& raw) {
+    lineNum++;
+    string line = Trim(raw);
+    if (line.empty() || line[0] == '#')
+        return;
+
+    if (line[0] == '[') {
+        if (line.back() != ']')
+            Fail("expected ] at the end of the section");
+        vector<string> words = Words(line.substr(1, line.size() - 2));
+        string kind = words.empty() ? "" : words[0];
+        string id = words.size() > 1 ? words[1] : "";
+        if (words.size() > 2)
+            Fail("ids cannot have spaces");
+        if (kind == "enemy")       Begin(enemies, ENEMY, id);
+        else if (kind == "weapon") Begin(weapons, WEAPON, id);
+        else if (kind == "hazard") Begin(hazards, HAZARD, id);
+        else if (kind == "reloc")  Begin(relocs, RELOC, id);
+        else if (kind == "level") {
+            if (!id.empty())
+                Fail("levels have no id, they go in order");
+            levelIds.push_back({lineNum, "", "", "", "", LevelDef()});
+            section = LEVEL;
+        } else {
+            Fail("unknown section \"" + kind + "\"");
+        }
+        return;
+    }
+
+    size_t equals = line.find('=');
+    if (equals == string::npos)
+        Fail("expected key = value");
+    string key = Trim(line.substr(0, equals));
+    string value = Trim(line.substr(equals + 1));
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+        value = value.substr(1, value.size() - 2);
+    value = Unescape(value);
+    switch (section) {
+        case ENEMY:  SetEnemy(enemies.back(), key, value); break;
+        case WEAPON: SetWeapon(weapons.back(), key, value); break;
+        case HAZARD: SetHazard(hazards.back(), key, value); break;
+        case RELOC:  SetReloc(relocs.back(), key, value); break;
+        case LEVEL:  SetLevel(levelIds.back(), key, value); break;
+        case NONE:   Fail("key outside of a section");
+    }
+}
+
+// Looks up the ids each level names
+void Parser::Finish() {
+    for (const LevelIds& ids : levelIds) {
+        lineNum = ids.line;
+        LevelDef def = ids.counts;
+        def.enemy  = FindId(enemies, ids.enemy);
+        def.weapon = FindId(weapons, ids.weapon);
+        def.hazard = FindId(hazards, ids.hazard);
+        def.reloc  = FindId(relocs, ids.reloc);
+        if (def.enemy < 0)
+            Fail("level needs an enemy that is defined, not \"" + ids.enemy + "\"");
+        if (def.weapon < 0)
+            Fail("level needs a weapon that is defined, not \"" + ids.weapon + "\"");
+        if (def.hazard < 0)
+            Fail("level needs a hazard that is defined, not \"" + ids.hazard + "\"");
+        if (def.reloc < 0)
+            Fail("level needs a reloc that is defined, not \"" + ids.reloc + "\"");
+        levels.push_back(def);
+    }
+    if (levels.empty())
+        throw invalid_argument("level definitions have no [level]");
+}
+
+LevelTable LevelTable::Parse(const string& text) {
+    Parser parser;
+    istringstream in(text);
+    string line;
+    while (getline(in, line))
+        parser.Line(line);
+    parser.Finish();
+
+    LevelTable table;
+    table.enemies = move(parser.enemies);
+    table.weapons = move(parser.weapons);
+    table.hazards = move(parser.hazards);
+    table.relocs  = move(parser.relocs);
+    table.levels  = move(parser.levels);
+    return table;
+}
+
+LevelTable LevelTable::Load(const string& path) {
+    ifstream file(path, ios::binary);
+    if (!file.is_open())
+        throw runtime_error("cannot read level definitions " + path);
+    stringstream buffer;
+    buffer << file.rdbuf();
+    return Parse(buffer.str());
+}
+
+const LevelTable& LevelTable::Default() {
+    static const LevelTable table = Parse(DEFAULT_LEVELS);
+    return table;
+}
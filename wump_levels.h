@@ -0,0 +1,110 @@
+/*
+ * Wump.2 - level definitions
+ *
+ * What each level's enemy, weapon, hazard and relocator are, with their
+ * odds, messages and images, comes from a level-definition file (see
+ * wump_levels.txt for the format) instead of being compiled in. A file is
+ * loaded once into a LevelTable: one contiguous, read-only table per kind
+ * of thing, and a list of levels that refer to entries by index. Every
+ * Level of every Game shares the table; nothing is copied per level.
+ *
+ * LevelTable::Default() is the built-in set, the same as wump_levels.txt.
+ */
+
+#ifndef WUMP_LEVELS_H
+#define WUMP_LEVELS_H
+
+#include <string>
+#include <vector>
+
+// how a startled enemy picks the tunnel it runs down
+enum class EnemyMove {
+    Random,     // any of them
+    Away,       // one leading furthest from the player
+    Toward      // one leading nearest the player
+};
+
+class Enemy {
+public:
+    std::string id;                     // as named in the file
+    std::string name;                   // e.g. "Spider"
+    std::string warningMsg;
+    std::string killedItMsg;
+    std::string killedYouMsg;
+    float pMove = 1;                    // chance it moves when startled
+    EnemyMove moves = EnemyMove::Random;
+    int warnRadius = 1;                 // heard up to this many tunnels away
+    std::vector<std::string> killedItImages;
+    std::vector<std::string> killedYouImages;
+};
+
+class Weapon {
+public:
+    std::string id;
+    std::string name;
+    bool isLimited = false;             // needs ammo to attack
+    int  ammo = 0;                      // ammo that comes with it
+    float pToHit = 1;                   // when the enemy walks into you
+    std::string foundMsg;
+    std::vector<std::string> foundImages;
+    std::vector<std::string> attackImages;
+};
+
+class Hazard {
+public:
+    std::string id;
+    std::string nearMsg;
+    std::string killedYouMsg;
+    int warnRadius = 1;
+    std::vector<std::string> images;
+};
+
+class Relocator {
+public:
+    std::string id;
+    std::string nearMsg;
+    std::string savedMsg;
+    std::string movedMsg;
+    std::string snatchedMsg;
+    int warnRadius = 1;
+    std::vector<std::string> images;
+};
+
+// a level: indexes into the LevelTable's tables, and how many of each
+// it places
+struct LevelDef {
+    int enemy;
+    int weapon;
+    int hazard;
+    int reloc;
+    int numEnemies = 1;     // all killed to clear the level
+    int numWeapons = 1;     // caches of the weapon; each one found adds its ammo
+    int numHazards = 2;
+    int numRelocs  = 2;
+};
+
+class LevelTable {
+private:
+    std::vector<Enemy> enemies;
+    std::vector<Weapon> weapons;
+    std::vector<Hazard> hazards;
+    std::vector<Relocator> relocs;
+    std::vector<LevelDef> levels;
+
+public:
+    // throws invalid_argument naming the line on a bad definition
+    static LevelTable Parse(const std::string& text);
+    // throws runtime_error if the file cannot be read
+    static LevelTable Load(const std::string& path);
+    // the built-in levels, parsed on first use
+    static const LevelTable& Default();
+
+    int NumLevels() const { return int(levels.size()); }
+    const LevelDef&  Def(int lev) const       { return levels[lev]; }
+    const Enemy&     GetEnemy(int lev) const  { return enemies[levels[lev].enemy]; }
+    const Weapon&    GetWeapon(int lev) const { return weapons[levels[lev].weapon]; }
+    const Hazard&    GetHazard(int lev) const { return hazards[levels[lev].hazard]; }
+    const Relocator& GetReloc(int lev) const  { return relocs[levels[lev].reloc]; }
+};
+
+#endif
@@ -0,0 +1,317 @@
+/*
+ * wump_loadgen - holds many sessions open on a wump_server and times turns
+ *
+ * usage: wump_loadgen [--port P] [--host ADDR] [--unix PATH]
+ *                     [--sessions N] [--seconds S] [--threads T]
+ *                     [--think MS] [--seed S]
+ *
+ * Opens N connections (1000 by default) and plays each one as a random
+ * wanderer: it moves down a random tunnel, now and then attacks one, and
+ * always replays after dying. Each connection waits for the prompt before
+ * sending its next command, plus --think milliseconds if given. A game
+ * that ends is replaced by a new connection. After S seconds (10) it
+ * reports the most sessions held at once, turns/sec and the turn latency
+ * percentiles, from sending a command to receiving the whole reply. Linux
+ * only.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "wump_rng.h"
+using namespace std;
+using Clock = chrono::steady_clock;
+
+const char* PROMPT = ">>> ";
+const size_t PROMPT_LENGTH = 4;
+const char* TUNNELS = "Tunnels lead to rooms \n";
+const char* REPLAY = "replay the same level?";
+const int MAX_EPOLL_EVENTS = 256;
+
+struct LoadOptions {
+    string host = "127.0.0.1";
+    int port = 7070;
+    string unixPath;
+    int sessions = 1000;
+    double seconds = 10;
+    int threads = 1;
+    int thinkMs = 0;
+    uint64_t seed = 1;
+};
+
+struct LoadStats {
+    long turns = 0;
+    long games = 0;         // connections the server ended
+    long failures = 0;      // connections that could not be made or broke
+    vector<uint32_t> latencies;     // microseconds, one per turn
+
+    void Add(const LoadStats& other) {
+        turns += other.turns;
+        games += other.games;
+        failures += other.failures;
+        latencies.insert(latencies.end(), other.latencies.begin(), other.latencies.end());
+    }
+};
+
+atomic<long> sessionsHeld(0);   // connected and past the first prompt
+atomic<long> sessionsPeak(0);
+
+struct Client {
+    int fd = -1;
+    bool held = false;
+    string in;
+    Clock::time_point sentAt;
+    Clock::time_point sendAt;   // when thinking is over
+    bool waiting = false;       // thinking, command not sent yet
+    vector<int> rooms;          // the tunnels of the room it is in
+};
+
+int Connect(const LoadOptions& options) {
+    int fd;
+    int result;
+    if (!options.unixPath.empty()) {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, options.unixPath.c_str(), sizeof(addr.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return -1;
+        result = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    } else {
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(uint16_t(options.port));
+        inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return -1;
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        result = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+    if (result < 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+// The next command for a reply that ended in a prompt
+string Choose(Client& client, Rng& rng) {
+    const string& reply = client.in;
+    if (reply.find(REPLAY) != string::npos)
+        return "replay\n";
+    size_t at = reply.rfind(TUNNELS);
+    if (at != string::npos) {
+        client.rooms.clear();
+        const char* p = reply.c_str() + at + strlen(TUNNELS);
+        char* end;
+        for (long room = strtol(p, &end, 10); end != p; room = strtol(p, &end, 10)) {
+            client.rooms.push_back(int(room));
+            p = end;
+        }
+    }
+    if (client.rooms.empty())
+        return "quit\n";
+    int room = client.rooms[rng(int(client.rooms.size()))];
+    return (rng(8) == 0 ? "attack " : "move ") + to_string(room) + "\n";
+}
+
+// Plays its share of the sessions until the deadline
+void RunWorker(int w, const LoadOptions& options, Clock::time_point deadline, LoadStats& stats) {
+    int count = options.sessions / options.threads + (w < options.sessions % options.threads ? 1 : 0);
+    Rng rng(options.seed + uint64_t(w));
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    vector<Client> clients(count);
+    auto think = chrono::milliseconds(options.thinkMs);
+
+    auto open = [&](int c) {
+        Client& client = clients[c];
+        client.fd = Connect(options);
+        client.held = false;
+        client.waiting = false;
+        client.in.clear();
+        client.rooms.clear();
+        if (client.fd < 0) {
+            stats.failures++;
+            return;
+        }
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u32 = uint32_t(c);
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, client.fd, &ev);
+    };
+    auto shut = [&](int c) {
+        Client& client = clients[c];
+        close(client.fd);
+        client.fd = -1;
+        if (client.held)
+            sessionsHeld.fetch_sub(1);
+    };
+    auto send = [&](int c, Clock::time_point now) {
+        Client& client = clients[c];
+        string command = Choose(client, rng);
+        client.in.clear();
+        client.waiting = false;
+        client.sentAt = now;
+        if (write(client.fd, command.data(), command.size()) != ssize_t(command.size())) {
+            stats.failures++;
+            shut(c);
+        }
+    };
+
+    for (int c = 0; c < count; c++)
+        open(c);
+
+    epoll_event events[MAX_EPOLL_EVENTS];
+    char buffer[4096];
+    while (Clock::now() < deadline) {
+        int n = epoll_wait(epollFd, events, MAX_EPOLL_EVENTS, options.thinkMs > 0 ? 1 : 100);
+        Clock::time_point now = Clock::now();
+        for (int i = 0; i < n; i++) {
+            int c = int(events[i].data.u32);
+            Client& client = clients[c];
+            if (client.fd < 0)
+                continue;
+            ssize_t got = read(client.fd, buffer, sizeof(buffer));
+            if (got < 0 && errno == EAGAIN)
+                continue;
+            if (got <= 0) {
+                if (got < 0)
+                    stats.failures++;
+                else
+                    stats.games++;
+                shut(c);
+                open(c);
+                continue;
+            }
+            client.in.append(buffer, size_t(got));
+            if (client.in.size() < PROMPT_LENGTH
+                || client.in.compare(client.in.size() - PROMPT_LENGTH, PROMPT_LENGTH, PROMPT) != 0)
+                continue;
+
+            // a whole reply
+            if (!client.held) {
+                client.held = true;
+                long held = sessionsHeld.fetch_add(1) + 1;
+                long peak = sessionsPeak.load();
+                while (held > peak && !sessionsPeak.compare_exchange_weak(peak, held)) {
+                }
+            } else {
+                stats.turns++;
+                stats.latencies.push_back(uint32_t(chrono::duration_cast<chrono::microseconds>(now - client.sentAt).count()));
+            }
+            if (options.thinkMs > 0) {
+                client.waiting = true;
+                client.sendAt = now + think;
+            } else {
+                send(c, now);
+            }
+        }
+        if (options.thinkMs > 0) {
+            for (int c = 0; c < count; c++) {
+                if (clients[c].fd >= 0 && clients[c].waiting && clients[c].sendAt <= now)
+                    send(c, now);
+            }
+        }
+    }
+    for (int c = 0; c < count; c++) {
+        if (clients[c].fd >= 0)
+            shut(c);
+    }
+    close(epollFd);
+}
+
+uint32_t Percentile(vector<uint32_t>& sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    size_t i = size_t(p * double(sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--port") == 0 && hasValue) {
+            options.port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--host") == 0 && hasValue) {
+            options.host = argv[++i];
+        } else if (strcmp(argv[i], "--unix") == 0 && hasValue) {
+            options.unixPath = argv[++i];
+        } else if (strcmp(argv[i], "--sessions") == 0 && hasValue) {
+            options.sessions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seconds") == 0 && hasValue) {
+            options.seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--think") == 0 && hasValue) {
+            options.thinkMs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        } else {
+            cerr << "usage: wump_loadgen [--port P] [--host ADDR] [--unix PATH] [--sessions N] "
+                 << "[--seconds S] [--threads T] [--think MS] [--seed S]" << endl;
+            return 2;
+        }
+    }
+    if (options.threads < 1)
+        options.threads = 1;
+    if (options.sessions < 1)
+        options.sessions = 1;
+
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    vector<LoadStats> perThread(options.threads);
+    vector<thread> workers;
+    auto begin = Clock::now();
+    auto deadline = begin + chrono::duration_cast<Clock::duration>(chrono::duration<double>(options.seconds));
+    for (int w = 1; w < options.threads; w++)
+        workers.emplace_back(RunWorker, w, cref(options), deadline, ref(perThread[w]));
+    RunWorker(0, options, deadline, perThread[0]);
+    for (thread& worker : workers)
+        worker.join();
+    double secs = chrono::duration<double>(Clock::now() - begin).count();
+
+    LoadStats stats;
+    for (const LoadStats& s : perThread)
+        stats.Add(s);
+    sort(stats.latencies.begin(), stats.latencies.end());
+
+    cout << "sessions        " << options.sessions << endl;
+    cout << "sessions held   " << sessionsPeak.load() << endl;
+    cout << "games ended     " << stats.games << endl;
+    cout << "failures        " << stats.failures << endl;
+    cout << "turns           " << stats.turns << endl;
+    cout << "seconds         " << secs << endl;
+    cout << "turns/sec       " << (secs > 0 ? stats.turns / secs : 0) << endl;
+    cout << "p50 us          " << Percentile(stats.latencies, 0.50) << endl;
+    cout << "p90 us          " << Percentile(stats.latencies, 0.90) << endl;
+    cout << "p99 us          " << Percentile(stats.latencies, 0.99) << endl;
+    cout << "max us          " << (stats.latencies.empty() ? 0 : stats.latencies.back()) << endl;
+    return stats.turns > 0 ? 0 : 1;
+}
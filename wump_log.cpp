@@ -0,0 +1,152 @@
+/*
+ * Wump.2 - binary turn log, see wump_log.h
+ */
+
+#include "wump_log.h"
+#include <cstring>
+using namespace std;
+
+static const uint8_t kEndOfSteps = 0xff;
+
+static uint64_t ZigZag(int v) {
+    return (uint64_t(int64_t(v)) << 1) ^ uint64_t(int64_t(v) >> 63);
+}
+
+static int UnZigZag(uint64_t v) {
+    return int(int64_t(v >> 1) ^ -int64_t(v & 1));
+}
+
+void TurnLog::PutVarint(uint64_t v) {
+    while (v >= 0x80) {
+        buffer.push_back(char(uint8_t(v) | 0x80));
+        v >>= 7;
+    }
+    buffer.push_back(char(v));
+}
+
+void TurnLog::PutEvents(const StepResult& step) {
+    PutVarint(uint64_t(step.numEvents));
+    for (int i = 0; i < step.numEvents; i++) {
+        const Event& event = step.events[i];
+        buffer.push_back(char(event.type));
+        PutVarint(uint64_t(event.room + 1));
+        PutVarint(ZigZag(event.value));
+    }
+}
+
+// Call right after Level::Start()
+void TurnLog::BeginLevel(const Level& level, const StepResult& start) {
+    if (!wroteMagic) {
+        buffer.append(WUMP_LOG_MAGIC, sizeof(WUMP_LOG_MAGIC));
+        wroteMagic = true;
+    }
+    const CaveSpec& spec = level.GetCave().Spec();
+    PutVarint(uint64_t(level.LevelNum()));
+    PutVarint(uint64_t(spec.kind));
+    PutVarint(uint64_t(spec.width));
+    PutVarint(uint64_t(spec.height));
+    PutVarint(spec.seed);
+    PutVarint(uint64_t(level.MinStartDistance()));
+    uint64_t state[4];
+    level.StartRng().GetState(state);
+    for (int i = 0; i < 4; i++)
+        PutVarint(state[i]);
+    PutEvents(start);
+}
+
+void TurnLog::Step(const Action& action, const StepResult& step) {
+    buffer.push_back(char(action.type));
+    PutVarint(uint64_t(action.room + 1));
+    PutEvents(step);
+}
+
+void TurnLog::EndLevel(const LevelResult& result) {
+    buffer.push_back(char(kEndOfSteps));
+    buffer.push_back(char(result.climbDown | result.climbUp << 1 | result.wonGame << 2 |
+                          result.died << 3 | result.killedEnemy << 4));
+}
+
+bool LogReader::Open(const uint8_t* data, size_t size) {
+    ok = size >= sizeof(WUMP_LOG_MAGIC) && memcmp(data, WUMP_LOG_MAGIC, sizeof(WUMP_LOG_MAGIC)) == 0;
+    p = data + sizeof(WUMP_LOG_MAGIC);
+    end = data + size;
+    if (!ok)
+        p = end;
+    return ok;
+}
+
+uint64_t LogReader::GetVarint() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) {
+            ok = false;
+            return 0;
+        }
+        uint8_t b = *p++;
+        v |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return v;
+    }
+    ok = false;
+    return 0;
+}
+
+void LogReader::GetEvents(LevelRecord& record) {
+    uint64_t count = GetVarint();
+    for (uint64_t i = 0; ok && i < count; i++) {
+        if (p == end) {
+            ok = false;
+            return;
+        }
+        Event event;
+        event.type = EventType(*p++);
+        event.room = int(GetVarint()) - 1;
+        event.value = UnZigZag(GetVarint());
+        record.events.push_back(event);
+    }
+}
+
+bool LogReader::Next(LevelRecord& record) {
+    if (!ok || p == end)
+        return false;
+    record.events.clear();
+    record.steps.clear();
+    record.levelNum = int(GetVarint());
+    record.caveSpec.kind = CaveKind(GetVarint());
+    record.caveSpec.width = int(GetVarint());
+    record.caveSpec.height = int(GetVarint());
+    record.caveSpec.seed = GetVarint();
+    record.minDistance = int(GetVarint());
+    for (int i = 0; i < 4; i++)
+        record.rngState[i] = GetVarint();
+    GetEvents(record);
+    record.numStartEvents = record.events.size();
+
+    while (ok) {
+        if (p == end) {
+            ok = false;
+            break;
+        }
+        uint8_t type = *p++;
+        if (type == kEndOfSteps)
+            break;
+        LoggedStep step;
+        step.action.type = ActionType(type);
+        step.action.room = int(GetVarint()) - 1;
+        step.firstEvent = record.events.size();
+        GetEvents(record);
+        step.numEvents = record.events.size() - step.firstEvent;
+        record.steps.push_back(step);
+    }
+    if (!ok || p == end) {
+        ok = false;
+        return false;
+    }
+    uint8_t flags = *p++;
+    record.result.climbDown   = flags & 1;
+    record.result.climbUp     = flags & 2;
+    record.result.wonGame     = flags & 4;
+    record.result.died        = flags & 8;
+    record.result.killedEnemy = flags & 16;
+    return true;
+}
@@ -0,0 +1,84 @@
+/*
+ * Wump.2 - binary turn log
+ *
+ * One record per level played: everything needed to play it again (level,
+ * cave, start distance, the level's generator state at Start()), the
+ * events Start() produced, then every action with the events it produced,
+ * and the final LevelResult. Replaying a record through a fresh Level must
+ * give the same events and result; wump_replay does exactly that.
+ *
+ * A log file is "WUMPLOG1" followed by records. Numbers are LEB128
+ * varints, rooms are stored +1 so that -1 fits, event values zigzagged:
+ *
+ *   record  := level cave.kind cave.width cave.height cave.seed
+ *              minDistance rng[4] events step* 0xff result
+ *   step    := actionType room events
+ *   events  := count (type room value)*
+ *   result  := climbDown | climbUp << 1 | wonGame << 2 | died << 3 | killedEnemy << 4
+ */
+
+#ifndef WUMP_LOG_H
+#define WUMP_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "wump_engine.h"
+
+const char WUMP_LOG_MAGIC[8] = {'W', 'U', 'M', 'P', 'L', 'O', 'G', '1'};
+
+// Appends records to a buffer while a level is played
+class TurnLog {
+private:
+    std::string buffer;
+    bool wroteMagic = false;            // Clear() keeps going in the same log
+
+    void PutVarint(uint64_t);
+    void PutEvents(const StepResult&);
+
+public:
+    void BeginLevel(const Level&, const StepResult&);
+    void Step(const Action&, const StepResult&);
+    void EndLevel(const LevelResult&);
+
+    const std::string& Data() const { return buffer; }
+    void Clear() { buffer.clear(); }
+};
+
+struct LoggedStep {
+    Action action;
+    size_t firstEvent;      // into LevelRecord::events
+    size_t numEvents;
+};
+
+// One level as read back from a log; reused from record to record
+struct LevelRecord {
+    int levelNum;
+    CaveSpec caveSpec;
+    int minDistance;
+    uint64_t rngState[4];
+    size_t numStartEvents;              // events[0 .. numStartEvents)
+    std::vector<Event> events;
+    std::vector<LoggedStep> steps;
+    LevelResult result;
+};
+
+class LogReader {
+private:
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok;
+
+    uint64_t GetVarint();
+    void GetEvents(LevelRecord&);
+
+public:
+    // false if data does not start with WUMP_LOG_MAGIC
+    bool Open(const uint8_t* data, size_t size);
+    // false at the end of the log or on a damaged record (see Damaged)
+    bool Next(LevelRecord&);
+    bool Damaged() const { return !ok; }
+};
+
+#endif
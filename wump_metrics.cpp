@@ -0,0 +1,225 @@
+/*
+ * Wump.2 - built-in metrics, see wump_metrics.h
+ */
+
+#include "wump_metrics.h"
+#include <fstream>
+#include <iostream>
+#include <thread>
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+#ifndef _WIN32
+    #include <csignal>
+    #include <pthread.h>
+#endif
+using namespace std;
+
+mutex Metrics::registryLock;
+vector<Metrics::Block*> Metrics::registry;
+
+const char* CounterName(Counter counter) {
+    switch (counter) {
+        case Counter::Levels:         return "levels";
+        case Counter::Turns:          return "turns";
+        case Counter::Moves:          return "moves";
+        case Counter::Attacks:        return "attacks";
+        case Counter::BatRelocations: return "bat_relocations";
+        case Counter::PitDeaths:      return "pit_deaths";
+        case Counter::EnemyKills:     return "enemy_kills";
+        case Counter::EnemyDeaths:    return "enemy_deaths";
+        case Counter::EnemyMoves:     return "enemy_moves";
+        case Counter::Restarts:       return "restarts";
+        case Counter::kCount:         break;
+    }
+    return "?";
+}
+
+const char* TimingName(Timing which) {
+    switch (which) {
+        case Timing::Turn:   return "turn";
+        case Timing::Render: return "render";
+        case Timing::kCount: break;
+    }
+    return "?";
+}
+
+static int HighBit(uint64_t x) {
+    #ifdef _MSC_VER
+        unsigned long i;
+        _BitScanReverse64(&i, x);
+        return int(i);
+    #else
+        return 63 - __builtin_clzll(x);
+    #endif
+}
+
+// exact below kSub, then kSub buckets per power of two
+int LatencyHistogram::Bucket(uint64_t ns) {
+    if (ns < uint64_t(kSub))
+        return int(ns);
+    int shift = HighBit(ns) - kSubBits;
+    return (shift + 1) * kSub + int((ns >> shift) & (kSub - 1));
+}
+
+uint64_t LatencyHistogram::BucketLow(int bucket) {
+    if (bucket < kSub)
+        return uint64_t(bucket);
+    int shift = bucket / kSub - 1;
+    return (uint64_t(kSub) + uint64_t(bucket % kSub)) << shift;
+}
+
+uint64_t LatencyHistogram::BucketHigh(int bucket) {
+    if (bucket < kSub)
+        return uint64_t(bucket);
+    int shift = bucket / kSub - 1;
+    return BucketLow(bucket) + ((uint64_t(1) << shift) - 1);
+}
+
+// only ever called by the thread that owns the histogram
+void LatencyHistogram::Record(uint64_t ns) {
+    atomic<uint64_t>& c = counts[Bucket(ns)];
+    c.store(c.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    total.store(total.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    sum.store(sum.load(memory_order_relaxed) + ns, memory_order_relaxed);
+    if (ns > max.load(memory_order_relaxed))
+        max.store(ns, memory_order_relaxed);
+}
+
+void LatencySummary::Add(const LatencyHistogram& histogram) {
+    if (counts.empty())
+        counts.assign(LatencyHistogram::kBuckets, 0);
+    for (int i = 0; i < LatencyHistogram::kBuckets; i++)
+        counts[i] += histogram.counts[i].load(memory_order_relaxed);
+    total += histogram.total.load(memory_order_relaxed);
+    sum += histogram.sum.load(memory_order_relaxed);
+    uint64_t m = histogram.max.load(memory_order_relaxed);
+    if (m > max)
+        max = m;
+}
+
+// the highest value of the bucket the p-th percentile falls in, like HDR
+uint64_t LatencySummary::Percentile(double p) const {
+    uint64_t seen = 0;
+    for (uint64_t c : counts)
+        seen += c;      // the buckets, not total: they may be a moment apart
+    if (seen == 0)
+        return 0;
+    uint64_t rank = uint64_t(p / 100 * double(seen) + 0.5);
+    if (rank < 1)
+        rank = 1;
+    if (rank > seen)
+        rank = seen;
+    uint64_t below = 0;
+    for (int i = 0; i < LatencyHistogram::kBuckets; i++) {
+        below += counts[i];
+        if (below >= rank)
+            return std::min(LatencyHistogram::BucketHigh(i), max);
+    }
+    return max;
+}
+
+static const double percentiles[] = {50, 90, 99, 99.9};
+static const char* percentileNames[] = {"p50", "p90", "p99", "p99.9"};
+
+void MetricsReport::WriteText(ostream& out) const {
+    out << "metrics (" << threads << " threads)" << endl;
+    for (int i = 0; i < int(Counter::kCount); i++) {
+        string name = CounterName(Counter(i));
+        out << "  " << name << string(18 - name.size(), ' ') << counters[i] << endl;
+    }
+    for (int i = 0; i < int(Timing::kCount); i++) {
+        const LatencySummary& t = timings[i];
+        string name = TimingName(Timing(i));
+        out << "  " << name << string(18 - name.size(), ' ') << t.total << " timed";
+        if (t.total) {
+            out << ", mean " << uint64_t(t.Mean()) << " ns";
+            for (int p = 0; p < 4; p++)
+                out << ", " << percentileNames[p] << " " << t.Percentile(percentiles[p]);
+            out << ", max " << t.max << " ns";
+        }
+        out << endl;
+    }
+}
+
+// the non-empty buckets too, as [low, high, count], so dumps can be merged
+void MetricsReport::WriteJson(ostream& out) const {
+    out << "{\n  \"threads\": " << threads << ",\n  \"counters\": {";
+    for (int i = 0; i < int(Counter::kCount); i++)
+        out << (i ? ", " : "") << "\"" << CounterName(Counter(i)) << "\": " << counters[i];
+    out << "},\n  \"timings\": {";
+    for (int i = 0; i < int(Timing::kCount); i++) {
+        const LatencySummary& t = timings[i];
+        out << (i ? "," : "") << "\n    \"" << TimingName(Timing(i)) << "\": {\"count\": " << t.total
+            << ", \"mean_ns\": " << uint64_t(t.Mean()) << ", \"max_ns\": " << t.max;
+        for (int p = 0; p < 4; p++)
+            out << ", \"" << percentileNames[p] << "_ns\": " << t.Percentile(percentiles[p]);
+        out << ", \"buckets\": [";
+        bool first = true;
+        for (int b = 0; b < int(t.counts.size()); b++) {
+            if (t.counts[b] == 0)
+                continue;
+            out << (first ? "" : ", ") << "[" << LatencyHistogram::BucketLow(b) << ", "
+                << LatencyHistogram::BucketHigh(b) << ", " << t.counts[b] << "]";
+            first = false;
+        }
+        out << "]}";
+    }
+    out << "\n  }\n}" << endl;
+}
+
+Metrics::Block* Metrics::Register() {
+    Block* block = new Block;
+    lock_guard<mutex> hold(registryLock);
+    registry.push_back(block);
+    mine = block;
+    return block;
+}
+
+MetricsReport Metrics::Collect() {
+    MetricsReport report;
+    for (int i = 0; i < int(Timing::kCount); i++)
+        report.timings[i].counts.assign(LatencyHistogram::kBuckets, 0);
+    lock_guard<mutex> hold(registryLock);
+    for (const Block* block : registry) {
+        for (int i = 0; i < int(Counter::kCount); i++)
+            report.counters[i] += block->counters[i].load(memory_order_relaxed);
+        for (int i = 0; i < int(Timing::kCount); i++)
+            report.timings[i].Add(block->timings[i]);
+    }
+    report.threads = int(registry.size());
+    return report;
+}
+
+bool Metrics::Dump(const string& path) {
+    MetricsReport report = Collect();
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (path == "-") {
+        report.WriteText(cout);
+        return bool(cout);
+    }
+    ofstream out(path, ios::trunc);
+    if (json)
+        report.WriteJson(out);
+    else
+        report.WriteText(out);
+    return bool(out);
+}
+
+void Metrics::DumpOnSignal(const string& path) {
+    #ifndef _WIN32
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGUSR1);
+        pthread_sigmask(SIG_BLOCK, &set, nullptr);
+        thread([path, set]() {
+            for (;;) {
+                int sig;
+                if (sigwait(&set, &sig) == 0 && !Dump(path))
+                    cerr << "metrics: cannot write " << path << endl;
+            }
+        }).detach();
+    #else
+        (void)path;
+    #endif
+}
@@ -0,0 +1,150 @@
+/*
+ * Wump.2 - built-in metrics: event counters and latency histograms
+ *
+ * The engine counts what happens (turns, moves, attacks, bat relocations,
+ * pit deaths, enemy moves, restarts, ...) and the front ends time turns
+ * and rendering. Every thread writes only its own block, registered the
+ * first time it counts anything and kept after the thread exits, so
+ * counting is a plain load and store of a relaxed atomic: no lock, no
+ * shared cache line. Collect() adds up every thread's block whenever it
+ * is asked to, while they keep counting.
+ *
+ * Histograms are HDR-style: exact below 32 ns, then 32 buckets per power
+ * of two, so any latency up to hours is kept within about 3%. Timing
+ * costs two clock reads, so it is off until EnableTiming(); counters are
+ * always on.
+ *
+ * Dump() writes everything as text, or as JSON when the file name ends in
+ * ".json"; DumpOnSignal() also dumps on SIGUSR1 (not on Windows).
+ */
+
+#ifndef WUMP_METRICS_H
+#define WUMP_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum class Counter {
+    Levels,             // Start()
+    Turns,              // Step()
+    Moves,
+    Attacks,            // attacks made, ammo spent
+    BatRelocations,     // dropped somewhere else by the bats
+    PitDeaths,
+    EnemyKills,         // the player killed the enemy
+    EnemyDeaths,        // the enemy killed the player
+    EnemyMoves,         // startled and moved, MoveStartledEnemy()
+    Restarts,           // PlayAgain()
+    kCount
+};
+
+enum class Timing {
+    Turn,               // one Step(); in the server, a command line to its reply
+    Render,             // one image presented
+    kCount
+};
+
+const char* CounterName(Counter);
+const char* TimingName(Timing);
+
+// One writer, any number of readers
+class LatencyHistogram {
+public:
+    static const int kSubBits = 5;
+    static const int kSub = 1 << kSubBits;
+    static const int kBuckets = (64 - kSubBits + 1) * kSub;
+
+    static int Bucket(uint64_t ns);
+    static uint64_t BucketLow(int bucket);
+    static uint64_t BucketHigh(int bucket);     // the highest value it holds
+
+    void Record(uint64_t ns);
+
+    std::atomic<uint64_t> counts[kBuckets] = {};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+};
+
+// Histogram totals of every thread
+struct LatencySummary {
+    std::vector<uint64_t> counts;       // LatencyHistogram::kBuckets
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    void Add(const LatencyHistogram&);
+    uint64_t Percentile(double p) const;    // p in [0, 100]; 0 if empty
+    double Mean() const { return total ? double(sum) / double(total) : 0; }
+};
+
+struct MetricsReport {
+    uint64_t counters[int(Counter::kCount)] = {};
+    LatencySummary timings[int(Timing::kCount)];
+    int threads = 0;
+
+    void WriteText(std::ostream&) const;
+    void WriteJson(std::ostream&) const;
+};
+
+class Metrics {
+private:
+    struct Block {
+        std::atomic<uint64_t> counters[int(Counter::kCount)] = {};
+        LatencyHistogram timings[int(Timing::kCount)];
+    };
+    static inline thread_local Block* mine = nullptr;
+    static inline std::atomic<bool> timing{false};
+    static std::mutex registryLock;
+    static std::vector<Block*> registry;   // every thread's, kept after it exits
+
+    static Block* Register();
+    static Block& ThisThread() { return mine ? *mine : *Register(); }
+
+public:
+    static void Count(Counter counter, uint64_t n = 1) {
+        std::atomic<uint64_t>& c = ThisThread().counters[int(counter)];
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    static void Record(Timing which, uint64_t ns) { ThisThread().timings[int(which)].Record(ns); }
+
+    static void EnableTiming(bool on = true) { timing.store(on, std::memory_order_relaxed); }
+    static bool TimingEnabled() { return timing.load(std::memory_order_relaxed); }
+
+    static MetricsReport Collect();
+    // "-" is stdout; false if the file cannot be written
+    static bool Dump(const std::string& path);
+    // call before starting any thread: SIGUSR1 is blocked in this one and
+    // so in every thread it starts, and a thread of its own waits for it
+    static void DumpOnSignal(const std::string& path);
+};
+
+// Times its scope into a histogram, if timing is enabled
+class MetricsTimer {
+private:
+    Timing which;
+    bool on;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit MetricsTimer(Timing w) : which(w), on(Metrics::TimingEnabled()) {
+        if (on)
+            start = std::chrono::steady_clock::now();
+    }
+    ~MetricsTimer() {
+        if (on) {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            Metrics::Record(which, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+    MetricsTimer(const MetricsTimer&) = delete;
+    MetricsTimer& operator=(const MetricsTimer&) = delete;
+};
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ * Wump.2 - room occupancy index, see wump_occupancy.h
+ */
+
+#include "wump_occupancy.h"
+using namespace std;
+
+void OccupancyIndex::Reset(const Cave& myCave, const int radii[kKinds]) {
+    cave = &myCave;
+    numRooms = cave->NumRooms();
+    nearKinds = 0;
+    for (int kind = 0; kind < kKinds; kind++) {
+        radius[kind] = radii[kind];
+        if (radius[kind] == 1)
+            nearKinds |= 1 << kind;
+    }
+    holds.assign(numRooms, 0);
+    heard.assign(numRooms, 0);
+    counts.assign(size_t(numRooms) * kKinds, 0);
+    heardCounts.assign(size_t(numRooms) * kKinds, 0);
+}
+
+// Counts a thing of kind in room as heard (delta 1) or no longer heard
+// (-1) in every room within its radius, a row of the distance table; only
+// for radii over one
+void OccupancyIndex::Spread(int room, int kind, int delta) {
+    uint8_t flag = uint8_t(1 << kind);
+    auto touch = [&](int near) {
+        uint16_t& n = heardCounts[size_t(near) * kKinds + kind];
+        n = uint16_t(n + delta);
+        if (n)
+            heard[near] |= flag;
+        else
+            heard[near] &= uint8_t(~flag);
+    };
+    for (int near = 0; near < numRooms; near++) {
+        int distance = cave->Distance(room, near);
+        if (distance > 0 && distance <= radius[kind])
+            touch(near);
+    }
+}
+
+// what the neighbors hold, no branches, and whatever further off is in range
+int OccupancyIndex::Heard(int room) const {
+    const int* nbr = cave->Neighbors(room);
+    int degree = cave->Degree(room);
+    int warnings = 0;
+    for (int j = 0; j < degree; j++)
+        warnings |= holds[nbr[j]];
+    return (warnings & nearKinds) | heard[room];
+}
@@ -0,0 +1,74 @@
+/*
+ * Wump.2 - what is in each room, and what can be heard there
+ *
+ * A level can hold any number of enemies, bats, pits and weapons, so
+ * nothing asks "is this the enemy's room" thing by thing. The index keeps,
+ * for every room, how many of each kind are in it and a byte of flags of
+ * the kinds it holds, so what a room holds is one load however many things
+ * the level has. Warnings heard from the next room only are the neighbors'
+ * flags ORed together, as many loads as tunnels; for kinds heard further
+ * off it also counts, per room, how many can be heard there, and moving
+ * one of those updates every room within its radius.
+ *
+ * Kinds are named by the same flags as the warnings: WARN_ENEMY,
+ * WARN_BATS and WARN_DRAFT (wump_engine.h), and HOLDS_WEAPON, which
+ * nothing warns of.
+ */
+
+#ifndef WUMP_OCCUPANCY_H
+#define WUMP_OCCUPANCY_H
+
+#include <cstdint>
+#include <vector>
+#include "wump_cave.h"
+
+const int HOLDS_WEAPON = 8;
+
+class OccupancyIndex {
+public:
+    static const int kKinds = 4;        // one per flag, lowest bit first
+
+private:
+    const Cave* cave;
+    int numRooms;
+    int radius[kKinds];                 // 0: not heard at all
+    int nearKinds;                      // flags of the kinds with radius 1
+    std::vector<uint8_t> holds;         // flags of the kinds in each room
+    std::vector<uint8_t> heard;         // flags of the further kinds heard in each room
+    std::vector<uint16_t> counts;       // [room * kKinds + kind]
+    std::vector<uint16_t> heardCounts;  // the same, for the further kinds
+
+    // what is one flag
+    static int Kind(int what) { return what == 8 ? 3 : what >> 1; }
+    void Spread(int room, int kind, int delta);
+
+public:
+    OccupancyIndex() : cave(nullptr), numRooms(0), radius{}, nearKinds(0) {}
+
+    // an empty cave; radii are indexed by kind, a radius over one needs
+    // the cave's distance table
+    void Reset(const Cave&, const int radii[kKinds]);
+
+    // what is one flag; a room holds at most 65535 of a kind
+    void Add(int room, int what) {
+        int kind = Kind(what);
+        counts[size_t(room) * kKinds + kind]++;
+        holds[room] |= uint8_t(what);
+        if (radius[kind] > 1)
+            Spread(room, kind, 1);
+    }
+    void Remove(int room, int what) {
+        int kind = Kind(what);
+        if (--counts[size_t(room) * kKinds + kind] == 0)
+            holds[room] &= uint8_t(~what);
+        if (radius[kind] > 1)
+            Spread(room, kind, -1);
+    }
+    void Move(int from, int to, int what) { Remove(from, what); Add(to, what); }
+
+    int Holds(int room) const { return holds[room]; }
+    int Heard(int room) const;
+    int Count(int room, int what) const { return counts[size_t(room) * kKinds + Kind(what)]; }
+};
+
+#endif
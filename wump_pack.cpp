@@ -0,0 +1,112 @@
+/*
+ * wump_pack - packs the ascii_img files into one bundle (see wump_assets.h)
+ *
+ * usage: wump_pack [--header] OUT FILE...
+ *
+ * Each file is stored under its base name, so "ascii_img/bow" is looked up
+ * as "bow". With --header OUT is a C++ header holding the bundle as a byte
+ * array, for building the game with WUMP_EMBED_ASSETS.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "wump_assets.h"
+using namespace std;
+
+struct PackFile {
+    string name;
+    string data;
+};
+
+static void PutU32(string& out, uint32_t v) {
+    for (int i = 0; i < 4; i++)
+        out.push_back(char((v >> (8 * i)) & 0xff));
+}
+
+int main(int argc, char* argv[]) {
+    int arg = 1;
+    bool header = false;
+    if (arg < argc && strcmp(argv[arg], "--header") == 0) {
+        header = true;
+        arg++;
+    }
+    if (argc - arg < 2) {
+        cerr << "usage: wump_pack [--header] OUT FILE..." << endl;
+        return 2;
+    }
+    string outPath = argv[arg++];
+
+    vector<PackFile> files;
+    for (; arg < argc; arg++) {
+        string path = argv[arg];
+        ifstream in(path, ios::binary);
+        if (!in.is_open()) {
+            cerr << "wump_pack: could not open " << path << endl;
+            return 1;
+        }
+        stringstream buffer;
+        buffer << in.rdbuf();
+        PackFile file;
+        size_t slash = path.find_last_of("/\\");
+        file.name = slash == string::npos ? path : path.substr(slash + 1);
+        file.data = buffer.str();
+        if (!file.data.empty() && file.data.back() != '\n')
+            file.data.push_back('\n');  // CatFile always ended the last line
+        files.push_back(file);
+    }
+    sort(files.begin(), files.end(),
+         [](const PackFile& a, const PackFile& b) { return a.name < b.name; });
+    for (size_t i = 1; i < files.size(); i++) {
+        if (files[i].name == files[i - 1].name) {
+            cerr << "wump_pack: duplicate name " << files[i].name << endl;
+            return 1;
+        }
+    }
+
+    // header, index, names, data
+    string names, data, pak;
+    size_t indexEnd = 16 + files.size() * sizeof(PakEntry);
+    for (const PackFile& file : files)
+        names += file.name;
+    pak.append(WUMP_PAK_MAGIC, sizeof(WUMP_PAK_MAGIC));
+    PutU32(pak, uint32_t(files.size()));
+    PutU32(pak, 0);
+    size_t nameOffset = indexEnd;
+    size_t dataOffset = indexEnd + names.size();
+    for (const PackFile& file : files) {
+        PutU32(pak, uint32_t(nameOffset));
+        PutU32(pak, uint32_t(file.name.size()));
+        PutU32(pak, uint32_t(dataOffset));
+        PutU32(pak, uint32_t(file.data.size()));
+        nameOffset += file.name.size();
+        dataOffset += file.data.size();
+        data += file.data;
+    }
+    pak += names;
+    pak += data;
+
+    ofstream out(outPath, ios::binary);
+    if (!out.is_open()) {
+        cerr << "wump_pack: could not write " << outPath << endl;
+        return 1;
+    }
+    if (header) {
+        out << "// generated by wump_pack, do not edit\n";
+        out << "static const unsigned char wumpEmbeddedPak[] = {";
+        for (size_t i = 0; i < pak.size(); i++) {
+            if (i % 16 == 0)
+                out << "\n   ";
+            out << ' ' << unsigned((unsigned char)pak[i]) << ',';
+        }
+        out << "\n};\n";
+    } else {
+        out.write(pak.data(), pak.size());
+    }
+    return out.good() ? 0 : 1;
+}
@@ -0,0 +1,38 @@
+/*
+ * Wump.2 - placement without rejection sampling, see wump_place.h
+ */
+
+#include "wump_place.h"
+#include <stdexcept>
+#include <unordered_set>
+using namespace std;
+
+// Leaves the start room, and every room less than minDistance tunnels
+// from it, out of the deck. Only those rooms are visited.
+void RoomSampler::Reset(const Cave& cave, int startRoom, int minDistance) {
+    numRooms = cave.NumRooms();
+    excluded.assign(1, startRoom);
+    unordered_set<int> seen(excluded.begin(), excluded.end());
+    vector<int> frontier(1, startRoom);
+    for (int d = 1; d < minDistance && !frontier.empty(); d++) {
+        vector<int> next;
+        for (int room : frontier) {
+            for (int j = 0; j < cave.Degree(room); j++) {
+                int nbr = cave.Neighbors(room)[j];
+                if (seen.insert(nbr).second) {
+                    excluded.push_back(nbr);
+                    next.push_back(nbr);
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+    sort(excluded.begin(), excluded.end());
+
+    shift.resize(excluded.size());
+    for (size_t j = 0; j < excluded.size(); j++)
+        shift[j] = excluded[j] - int(j);
+    deckSize = numRooms - int(excluded.size());
+    swapped.reserve(kShortList);    // Shuffle() keeps the memory
+    Shuffle();
+}
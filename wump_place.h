@@ -0,0 +1,143 @@
+/*
+ * Wump.2 - placement without rejection sampling
+ *
+ * RoomSampler deals out distinct rooms for a level's enemy, relocs, hazs
+ * and weapon. Its deck is every room except the start room and, with a
+ * minimum distance, the rooms closer than that to the start. Dealing is
+ * a partial Fisher-Yates shuffle that only remembers the positions it
+ * swapped: in a short list while there are a few, as for a classic level,
+ * and in a hash table past that. Dealing k rooms costs O(k log e) expected
+ * for e excluded rooms however large the cave is, and never retries;
+ * Reset() costs O(e log e).
+ *
+ * Randomness comes from the caller: below(n) must return a uniform
+ * integer in [0, n).
+ */
+
+#ifndef WUMP_PLACE_H
+#define WUMP_PLACE_H
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "wump_cave.h"
+
+class RoomSampler {
+private:
+    int numRooms;
+    int deckSize;                  // rooms that may be dealt
+    std::vector<int> excluded;     // sorted rooms left out of the deck
+    std::vector<int> shift;        // excluded[j] - j, to map deck slots to rooms
+    static const size_t kShortList = 8;
+    std::vector<std::pair<int, int>> swapped;  // deck slot -> slot it now holds, while short
+    std::unordered_map<int, int> swappedMap;   // the same, once past kShortList
+    bool useMap;
+    int dealt;
+
+    int Slot(int i) const {
+        if (useMap) {
+            auto found = swappedMap.find(i);
+            return found == swappedMap.end() ? i : found->second;
+        }
+        for (const auto& s : swapped) {
+            if (s.first == i)
+                return s.second;
+        }
+        return i;
+    }
+    void SetSlot(int i, int value) {
+        if (useMap) {
+            swappedMap[i] = value;
+            return;
+        }
+        for (auto& s : swapped) {
+            if (s.first == i) {
+                s.second = value;
+                return;
+            }
+        }
+        if (swapped.size() < kShortList) {
+            swapped.push_back({i, value});
+            return;
+        }
+        // too many for a scan: move them all to the table
+        swappedMap.insert(swapped.begin(), swapped.end());
+        swappedMap[i] = value;
+        useMap = true;
+    }
+    // the i-th room of the deck, skipping the excluded ones
+    int RoomAt(int i) const {
+        return i + int(std::upper_bound(shift.begin(), shift.end(), i) - shift.begin());
+    }
+
+public:
+    RoomSampler() : numRooms(0), deckSize(0), useMap(false), dealt(0) {}
+
+    void Reset(const Cave&, int startRoom, int minDistance);
+    void Shuffle() {
+        swapped.clear();
+        if (useMap)
+            swappedMap.clear();
+        useMap = false;
+        dealt = 0;
+    }
+    int  DeckSize() const { return deckSize; }
+    int  Left() const { return deckSize - dealt; }
+
+    // next room from the deck; the deck must not be empty
+    template <class Below>
+    int Deal(Below& below) {
+        int pick = dealt + below(deckSize - dealt);
+        int room = Slot(pick);
+        SetSlot(pick, Slot(dealt));
+        dealt++;
+        return RoomAt(room);
+    }
+};
+
+// A uniform room in [lo, hi) other than the ones in except (at most 4,
+// duplicates and rooms out of range allowed), in one draw.
+template <class Below>
+int RoomExcept(Below& below, int lo, int hi, const int* except, int numExcept) {
+    int skip[4];
+    int n = 0;
+    for (int i = 0; i < numExcept && i < 4; i++) {
+        int room = except[i];
+        if (room < lo || room >= hi)
+            continue;
+        // insert sorted, dropping duplicates
+        int at = n;
+        while (at > 0 && skip[at - 1] > room)
+            at--;
+        if (at > 0 && skip[at - 1] == room)
+            continue;
+        for (int j = n; j > at; j--)
+            skip[j] = skip[j - 1];
+        skip[at] = room;
+        n++;
+    }
+    int room = lo + below(hi - lo - n);
+    for (int i = 0; i < n && skip[i] <= room; i++)
+        room++;
+    return room;
+}
+
+// The same for any number of rooms to skip, for crowded levels: except is
+// sorted, and rooms out of range and duplicates dropped, in place (its
+// memory is the caller's to reuse). O(m log m) for m rooms, one draw.
+template <class Below>
+int RoomExceptAll(Below& below, int lo, int hi, std::vector<int>& except) {
+    except.erase(std::remove_if(except.begin(), except.end(),
+                                [lo, hi](int room) { return room < lo || room >= hi; }),
+                 except.end());
+    std::sort(except.begin(), except.end());
+    except.erase(std::unique(except.begin(), except.end()), except.end());
+    int n = int(except.size());
+    int room = lo + below(hi - lo - n);
+    for (int i = 0; i < n && except[i] <= room; i++)
+        room++;
+    return room;
+}
+
+#endif
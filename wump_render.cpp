@@ -0,0 +1,263 @@
+/*
+ * Wump.2 - diff-based terminal renderer, see wump_render.h
+ */
+
+#include "wump_render.h"
+#include "wump_metrics.h"
+#include <cstdio>
+#ifdef _WIN32
+    #include <windows.h>
+    #include <io.h>
+#else
+    #include <sys/ioctl.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+using namespace std;
+
+static const uint32_t kBlank = ' ';
+
+TrackedBuf::int_type TrackedBuf::overflow(int_type c) {
+    written = true;
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+        return traits_type::not_eof(c);
+    return target->sputc(traits_type::to_char_type(c));
+}
+
+streamsize TrackedBuf::xsputn(const char* s, streamsize n) {
+    written = true;
+    return target->sputn(s, n);
+}
+
+int TrackedBuf::sync() {
+    return target->pubsync();
+}
+
+// conx
+Screen::Screen(int outFd) {
+    fd = outFd;
+    valid = false;
+    frontRows = frontCols = 0;
+    backRows = backCols = 0;
+    tracked = nullptr;
+    tracker = nullptr;
+    #ifdef _WIN32
+        isTerminal = _isatty(fd);
+        if (isTerminal) {
+            // let the console understand ANSI escapes
+            HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+            DWORD mode = 0;
+            if (GetConsoleMode(console, &mode))
+                SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+        }
+    #else
+        isTerminal = isatty(fd);
+    #endif
+}
+
+Screen::~Screen() {
+    if (tracked != nullptr) {
+        tracked->rdbuf(tracker->Target());
+        delete tracker;
+    }
+}
+
+// Text written to the stream from now on means the terminal no longer
+// holds just our last frame.
+void Screen::TrackOutput(ostream& stream) {
+    if (tracked != nullptr)
+        return;
+    tracked = &stream;
+    tracker = new TrackedBuf(stream.rdbuf());
+    stream.rdbuf(tracker);
+}
+
+// Splits the frame into rows of cells
+void Screen::Parse(const char* frame, size_t length) {
+    back.clear();
+    backRows = backCols = 0;
+
+    // first pass for the size, so back is laid out as rows x cols
+    int cols = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = frame[i];
+        if (c == '\n') {
+            backRows++;
+            if (cols > backCols)
+                backCols = cols;
+            cols = 0;
+        } else if (c != '\r' && (c & 0xc0) != 0x80) {
+            cols++;     // not a UTF-8 continuation byte
+        }
+    }
+    if (cols > 0) {
+        backRows++;
+        if (cols > backCols)
+            backCols = cols;
+    }
+    back.assign(size_t(backRows) * backCols, kBlank);
+
+    int r = 0, col = 0, shift = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = frame[i];
+        if (c == '\n') {
+            r++;
+            col = 0;
+        } else if (c == '\r') {
+            continue;
+        } else if ((c & 0xc0) == 0x80) {
+            if (col > 0 && shift < 32) {
+                back[size_t(r) * backCols + col - 1] |= uint32_t(c) << shift;
+                shift += 8;
+            }
+        } else {
+            back[size_t(r) * backCols + col] = c;
+            col++;
+            shift = 8;
+        }
+    }
+}
+
+bool Screen::FitsTerminal(int rows) const {
+    #ifdef _WIN32
+        CONSOLE_SCREEN_BUFFER_INFO info;
+        if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info))
+            return false;
+        int height = info.srWindow.Bottom - info.srWindow.Top + 1;
+    #else
+        struct winsize size;
+        if (ioctl(fd, TIOCGWINSZ, &size) != 0 || size.ws_row == 0)
+            return false;
+        int height = size.ws_row;
+    #endif
+    return rows < height;   // room left for the cursor below the frame
+}
+
+// Writes prefix and frame together, without copying the frame
+void Screen::WriteOut(const char* prefix, size_t prefixLength, const char* frame, size_t length) {
+    #ifdef _WIN32
+        string all(prefix, prefixLength);
+        all.append(frame, length);
+        const char* p = all.data();
+        size_t left = all.size();
+        while (left > 0) {
+            int n = _write(fd, p, (unsigned)left);
+            if (n <= 0)
+                return;
+            p += n;
+            left -= size_t(n);
+        }
+    #else
+        struct iovec iov[2];
+        iov[0].iov_base = (void*)prefix;
+        iov[0].iov_len = prefixLength;
+        iov[1].iov_base = (void*)frame;
+        iov[1].iov_len = length;
+        int first = 0;
+        while (first < 2) {
+            ssize_t n = writev(fd, iov + first, 2 - first);
+            if (n <= 0)
+                return;
+            while (first < 2 && size_t(n) >= iov[first].iov_len) {
+                n -= iov[first].iov_len;
+                first++;
+            }
+            if (first < 2) {
+                iov[first].iov_base = (char*)iov[first].iov_base + n;
+                iov[first].iov_len -= n;
+            }
+        }
+    #endif
+}
+
+// Home, clear, frame
+void Screen::WriteFull(const char* frame, size_t length) {
+    static const char clear[] = "\x1b[H\x1b[2J";
+    if (isTerminal)
+        WriteOut(clear, sizeof(clear) - 1, frame, length);
+    else
+        WriteOut("", 0, frame, length);
+}
+
+static void AppendCell(string& out, uint32_t cell) {
+    do {
+        out.push_back(char(cell & 0xff));
+        cell >>= 8;
+    } while (cell != 0);
+}
+
+static size_t CellBytes(uint32_t cell) {
+    size_t n = 0;
+    do {
+        n++;
+        cell >>= 8;
+    } while (cell != 0);
+    return n;
+}
+
+// Only the cells that differ from front, then clear everything below
+void Screen::WriteDiff() {
+    out.clear();
+    int rows = backRows > frontRows ? backRows : frontRows;
+    int cols = backCols > frontCols ? backCols : frontCols;
+    int curRow = -1, curCol = -1;
+    char move[32];
+
+    auto want = [&](int r, int c) {
+        return (r < backRows && c < backCols) ? back[size_t(r) * backCols + c] : kBlank;
+    };
+    auto have = [&](int r, int c) {
+        return (r < frontRows && c < frontCols) ? front[size_t(r) * frontCols + c] : kBlank;
+    };
+
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            uint32_t cell = want(r, c);
+            if (cell == have(r, c))
+                continue;
+            if (r != curRow || c != curCol) {
+                int n = snprintf(move, sizeof(move), "\x1b[%d;%dH", r + 1, c + 1);
+                // rewriting a short run of unchanged cells is cheaper than a move
+                size_t gap = 0;
+                if (r == curRow && c > curCol) {
+                    for (int g = curCol; g < c; g++)
+                        gap += CellBytes(want(r, g));
+                }
+                if (r == curRow && c > curCol && gap <= size_t(n)) {
+                    for (int g = curCol; g < c; g++)
+                        AppendCell(out, want(r, g));
+                } else {
+                    out.append(move, n);
+                }
+            }
+            AppendCell(out, cell);
+            curRow = r;
+            curCol = c + 1;
+        }
+    }
+    int n = snprintf(move, sizeof(move), "\x1b[%d;1H\x1b[J", backRows + 1);
+    out.append(move, n);
+    WriteOut(out.data(), out.size(), "", 0);
+}
+
+void Screen::Present(const char* frame, size_t length) {
+    MetricsTimer timer(Timing::Render);
+    if (tracked != nullptr) {
+        tracked->flush();   // text before the frame stays before it
+        if (tracker->written)
+            valid = false;
+    }
+
+    Parse(frame, length);
+    if (isTerminal && valid && FitsTerminal(backRows))
+        WriteDiff();
+    else
+        WriteFull(frame, length);
+
+    valid = isTerminal && FitsTerminal(backRows);
+    front.swap(back);
+    frontRows = backRows;
+    frontCols = backCols;
+    if (tracker != nullptr)
+        tracker->written = false;
+}
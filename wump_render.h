@@ -0,0 +1,70 @@
+/*
+ * Wump.2 - diff-based terminal renderer
+ *
+ * Screen keeps a copy of the last frame it drew. Presenting the next frame
+ * only sends the cells that changed, positioned with ANSI cursor moves, and
+ * the whole frame goes out in one write. Nothing forks a shell to clear.
+ *
+ * The copy is only trusted while nothing else wrote to the terminal: text
+ * written through a tracked stream (see TrackOutput) since the last frame,
+ * or a frame taller than the terminal, makes the next frame a full redraw
+ * (still one write, from the bundle's mapping). When stdout is not a
+ * terminal frames are written as they are, like cat.
+ */
+
+#ifndef WUMP_RENDER_H
+#define WUMP_RENDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// streambuf that forwards to another one and remembers it was written to
+class TrackedBuf : public std::streambuf {
+private:
+    std::streambuf* target;
+public:
+    bool written;
+
+    TrackedBuf(std::streambuf* t) : target(t), written(false) {}
+    std::streambuf* Target() const { return target; }
+protected:
+    int_type overflow(int_type);
+    std::streamsize xsputn(const char*, std::streamsize);
+    int sync();
+};
+
+class Screen {
+private:
+    int  fd;
+    bool isTerminal;
+    bool valid;                   // front matches what is on the terminal
+    int  frontRows, frontCols;
+    std::vector<uint32_t> front;  // one UTF-8 character per cell
+    std::vector<uint32_t> back;
+    int  backRows, backCols;
+    std::string out;              // the escape sequences of one frame
+    std::ostream* tracked;
+    TrackedBuf*   tracker;
+
+    void Parse(const char*, size_t);
+    bool FitsTerminal(int rows) const;
+    void WriteFull(const char*, size_t);
+    void WriteDiff();
+    void WriteOut(const char* prefix, size_t prefixLength, const char*, size_t);
+
+public:
+    Screen(int outFd = 1);
+    ~Screen();
+    Screen(const Screen&) = delete;
+    Screen& operator=(const Screen&) = delete;
+
+    void TrackOutput(std::ostream&);
+    void Invalidate() { valid = false; }
+    void Present(const char* frame, size_t length);
+};
+
+#endif
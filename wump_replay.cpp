@@ -0,0 +1,186 @@
+/*
+ * wump_replay - plays turn logs back through the engine as fast as it can
+ *
+ * usage: wump_replay [--verbose] [--levels FILE] LOG...
+ *
+ * Every record in a log (see wump_log.h) is played again on a level set
+ * up the way the record says, and each step's events and the final
+ * LevelResult must come out the same. Prints the totals and records/sec;
+ * exits 1 if anything differed or a log could not be read. Logs made with
+ * --levels need the same --levels here.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "wump_engine.h"
+#include "wump_log.h"
+using namespace std;
+
+struct ReplayStats {
+    long records = 0;
+    long steps = 0;
+    long events = 0;
+    long mismatches = 0;
+};
+
+// Levels to play records on, one per cave and level number. Start() puts
+// a level back the same way every time, so they are reused.
+class LevelCache {
+private:
+    const LevelTable& table;
+    map<string, unique_ptr<Cave>> caves;
+    map<pair<string, int>, unique_ptr<Level>> levels;
+
+public:
+    LevelCache(const LevelTable& t) : table(t) {}
+    int NumLevels() const { return table.NumLevels(); }
+    Level& Get(const CaveSpec& spec, int levelNum) {
+        string name = CaveSpecName(spec);
+        unique_ptr<Level>& level = levels[make_pair(name, levelNum)];
+        if (!level) {
+            unique_ptr<Cave>& cave = caves[name];
+            if (!cave)
+                cave.reset(new Cave(Cave::Build(spec)));
+            level.reset(new Level(levelNum, *cave, table));
+        }
+        return *level;
+    }
+};
+
+static bool SameEvents(const StepResult& step, const Event* expected, size_t count) {
+    if (size_t(step.numEvents) != count)
+        return false;
+    for (size_t i = 0; i < count; i++) {
+        if (step.events[i].type != expected[i].type || step.events[i].room != expected[i].room ||
+            step.events[i].value != expected[i].value)
+            return false;
+    }
+    return true;
+}
+
+static bool SameResult(const LevelResult& a, const LevelResult& b) {
+    return a.climbDown == b.climbDown && a.climbUp == b.climbUp && a.wonGame == b.wonGame &&
+           a.died == b.died && a.killedEnemy == b.killedEnemy;
+}
+
+// Plays one record; returns "" when it matched, otherwise what went wrong
+static string Replay(const LevelRecord& record, LevelCache& cache, ReplayStats& stats) {
+    if (record.levelNum < 0 || record.levelNum >= cache.NumLevels())
+        return "bad level " + to_string(record.levelNum);
+    Level& level = cache.Get(record.caveSpec, record.levelNum);
+    if (level.MinStartDistance() != record.minDistance)
+        level.SetMinStartDistance(record.minDistance);
+    Rng rng;
+    rng.SetState(record.rngState);
+    level.SetRng(rng);
+
+    StepResult step = level.Start();
+    if (!SameEvents(step, record.events.data(), record.numStartEvents))
+        return "start events differ";
+    stats.events += step.numEvents;
+    for (size_t i = 0; i < record.steps.size(); i++) {
+        const LoggedStep& logged = record.steps[i];
+        if (level.Phase() == LevelPhase::Over)
+            return "level over before step " + to_string(i);
+        step = level.Step(logged.action);
+        if (!SameEvents(step, record.events.data() + logged.firstEvent, logged.numEvents))
+            return "events differ at step " + to_string(i);
+        stats.steps++;
+        stats.events += step.numEvents;
+    }
+    if (level.Phase() != LevelPhase::Over)
+        return "level not over after the last step";
+    if (!SameResult(level.Result(), record.result))
+        return "result differs";
+    return "";
+}
+
+int main(int argc, char* argv[]) {
+    bool verbose = false;
+    const char* levelsPath = nullptr;
+    vector<string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--verbose") == 0)
+            verbose = true;
+        else if (strcmp(argv[i], "--levels") == 0 && i + 1 < argc)
+            levelsPath = argv[++i];
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty()) {
+        cerr << "usage: wump_replay [--verbose] [--levels FILE] LOG..." << endl;
+        return 2;
+    }
+    LevelTable levels = LevelTable::Default();
+    try {
+        if (levelsPath)
+            levels = LevelTable::Load(levelsPath);
+    } catch (const exception& e) {
+        cerr << "wump_replay: " << e.what() << endl;
+        return 2;
+    }
+
+    // read everything first so the timing is the engine, not the disk
+    vector<string> logs;
+    for (const string& path : paths) {
+        ifstream in(path, ios::binary);
+        if (!in) {
+            cerr << "wump_replay: cannot read " << path << endl;
+            return 1;
+        }
+        logs.emplace_back(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+
+    ReplayStats stats;
+    LevelCache cache(levels);
+    LevelRecord record;
+    bool damaged = false;
+    auto begin = chrono::steady_clock::now();
+    for (size_t f = 0; f < logs.size(); f++) {
+        LogReader reader;
+        if (!reader.Open(reinterpret_cast<const uint8_t*>(logs[f].data()), logs[f].size())) {
+            cerr << "wump_replay: " << paths[f] << " is not a turn log" << endl;
+            damaged = true;
+            continue;
+        }
+        long index = 0;
+        while (reader.Next(record)) {
+            string problem;
+            try {
+                problem = Replay(record, cache, stats);
+            } catch (const exception& e) {
+                problem = e.what();
+            }
+            if (!problem.empty()) {
+                stats.mismatches++;
+                if (verbose || stats.mismatches <= 10)
+                    cerr << paths[f] << ": record " << index << " (level " << record.levelNum
+                         << ", " << CaveSpecName(record.caveSpec) << "): " << problem << endl;
+            }
+            stats.records++;
+            index++;
+        }
+        if (reader.Damaged()) {
+            cerr << "wump_replay: " << paths[f] << " is damaged after record " << index << endl;
+            damaged = true;
+        }
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    cout << "records         " << stats.records << endl;
+    cout << "steps           " << stats.steps << endl;
+    cout << "events          " << stats.events << endl;
+    cout << "mismatches      " << stats.mismatches << endl;
+    cout << "seconds         " << secs << endl;
+    cout << "records/sec     " << (secs > 0 ? stats.records / secs : 0) << endl;
+    cout << "steps/sec       " << (secs > 0 ? stats.steps / secs : 0) << endl;
+    return stats.mismatches == 0 && !damaged ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+/*
+ * Wump.2 - per-game random numbers
+ *
+ * xoshiro256** (Blackman & Vigna), seeded through splitmix64. Every Level
+ * owns one, so a game is reproducible from its seed and games on different
+ * threads share nothing. Jump() skips 2^128 draws; Split() hands out
+ * non-overlapping streams, e.g. one per worker thread or per level.
+ */
+
+#ifndef WUMP_RNG_H
+#define WUMP_RNG_H
+
+#include <cstdint>
+
+class Rng {
+private:
+    uint64_t s[4];
+
+    static uint64_t Rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+public:
+    Rng(uint64_t seed = 0) { Seed(seed); }
+
+    // splitmix64 step; also handy to derive one seed from another
+    static uint64_t Mix(uint64_t& x) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    void Seed(uint64_t seed) {
+        for (int i = 0; i < 4; i++)
+            s[i] = Mix(seed);
+    }
+
+    // raw state, for logs that must play a level again exactly
+    void GetState(uint64_t out[4]) const {
+        for (int i = 0; i < 4; i++)
+            out[i] = s[i];
+    }
+    void SetState(const uint64_t in[4]) {
+        for (int i = 0; i < 4; i++)
+            s[i] = in[i];
+    }
+
+    uint64_t Next() {
+        uint64_t result = Rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = Rotl(s[3], 45);
+        return result;
+    }
+
+    // uniform in [0, n) without modulo bias (Lemire's method)
+    uint32_t Below(uint32_t n) {
+        uint64_t m = (Next() >> 32) * n;
+        uint32_t low = uint32_t(m);
+        if (low < n) {
+            uint32_t threshold = uint32_t(-n) % n;
+            while (low < threshold) {
+                m = (Next() >> 32) * n;
+                low = uint32_t(m);
+            }
+        }
+        return uint32_t(m >> 32);
+    }
+    int operator()(int n) { return int(Below(uint32_t(n))); }
+
+    // uniform in [0, 1)
+    double Uniform() { return double(Next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    // true with probability p
+    bool Chance(double p) { return Uniform() < p; }
+
+    void Jump() {
+        static const uint64_t jump[4] = {
+            0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+            0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+        };
+        uint64_t t[4] = {0, 0, 0, 0};
+        for (int i = 0; i < 4; i++) {
+            for (int b = 0; b < 64; b++) {
+                if (jump[i] & (uint64_t(1) << b)) {
+                    for (int k = 0; k < 4; k++)
+                        t[k] ^= s[k];
+                }
+                Next();
+            }
+        }
+        for (int k = 0; k < 4; k++)
+            s[k] = t[k];
+    }
+
+    // a copy of this stream; this one jumps past everything the copy will draw
+    Rng Split() {
+        Rng stream = *this;
+        Jump();
+        return stream;
+    }
+};
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Wump.2 - sets of rooms, one bit per room
+ *
+ * Room counts depend on the cave, so the words live in a vector sized by
+ * Resize(); the set operations are plain loops over 64-bit words, which
+ * is one word for the classic 20-room cave.
+ */
+
+#ifndef WUMP_ROOMSET_H
+#define WUMP_ROOMSET_H
+
+#include <cstdint>
+#include <vector>
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+class RoomSet {
+private:
+    std::vector<uint64_t> words;
+    int numRooms = 0;
+
+#ifdef _MSC_VER
+    static int PopCount(uint64_t w) { return int(__popcnt64(w)); }
+    static int LowBit(uint64_t w) { unsigned long i; _BitScanForward64(&i, w); return int(i); }
+#else
+    static int PopCount(uint64_t w) { return __builtin_popcountll(w); }
+    static int LowBit(uint64_t w) { return __builtin_ctzll(w); }
+#endif
+
+public:
+    // empty set over rooms [0, rooms)
+    void Resize(int rooms) {
+        numRooms = rooms;
+        words.assign((rooms + 63) / 64, 0);
+    }
+    int  NumRooms() const { return numRooms; }
+
+    void Clear() {
+        for (uint64_t& w : words)
+            w = 0;
+    }
+    // every room of the cave
+    void Fill() {
+        for (uint64_t& w : words)
+            w = ~uint64_t(0);
+        if (numRooms % 64)
+            words.back() = (uint64_t(1) << (numRooms % 64)) - 1;
+    }
+
+    void Set(int room)   { words[room >> 6] |= uint64_t(1) << (room & 63); }
+    void Reset(int room) { words[room >> 6] &= ~(uint64_t(1) << (room & 63)); }
+    bool Test(int room) const { return (words[room >> 6] >> (room & 63)) & 1; }
+
+    int Count() const {
+        int n = 0;
+        for (uint64_t w : words)
+            n += PopCount(w);
+        return n;
+    }
+    bool Any() const {
+        for (uint64_t w : words)
+            if (w)
+                return true;
+        return false;
+    }
+    bool Intersects(const RoomSet& other) const {
+        for (size_t i = 0; i < words.size(); i++)
+            if (words[i] & other.words[i])
+                return true;
+        return false;
+    }
+    // count of this & other, without building it
+    int CountAnd(const RoomSet& other) const {
+        int n = 0;
+        for (size_t i = 0; i < words.size(); i++)
+            n += PopCount(words[i] & other.words[i]);
+        return n;
+    }
+
+    RoomSet& operator&=(const RoomSet& other) {
+        for (size_t i = 0; i < words.size(); i++)
+            words[i] &= other.words[i];
+        return *this;
+    }
+    RoomSet& operator|=(const RoomSet& other) {
+        for (size_t i = 0; i < words.size(); i++)
+            words[i] |= other.words[i];
+        return *this;
+    }
+    RoomSet& AndNot(const RoomSet& other) {
+        for (size_t i = 0; i < words.size(); i++)
+            words[i] &= ~other.words[i];
+        return *this;
+    }
+
+    // calls f(room) for every room in the set, lowest first
+    template <class F>
+    void ForEach(F f) const {
+        for (size_t i = 0; i < words.size(); i++) {
+            for (uint64_t w = words[i]; w; w &= w - 1)
+                f(int(i * 64 + LowBit(w)));
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,635 @@
+/*
+ * wump_server - hosts many Wump.2 games in one process
+ *
+ * usage: wump_server [--port P] [--host ADDR] [--unix PATH] [--threads T]
+ *                    [--seed S] [--cave SPEC] [--levels FILE]
+ *                    [--min-distance D] [--park DIR] [--metrics FILE]
+ *                    [--safe-levels] [--min-enemy-distance D] [--pool N]
+ *
+ * Each connection plays one game. The protocol is lines of text: the
+ * server sends what the console would print, without the images, and
+ * ends every reply that waits for a command with the prompt ">>> " (no
+ * newline). Commands are "move N", "attack N" and "quit", or "replay" and
+ * "quit" after dying; "m", "a", "q" and "r" work too. The connection is
+ * closed when the game is won or quit.
+ *
+ * There is one reactor thread per core (or --threads), each with its own
+ * epoll set and sessions; they share the listening socket, the cave and
+ * the level table, and nothing else. A session's game is a Dialog
+ * coroutine (wump_dialog.h) that suspends while it waits for a line, so
+ * it reads like the console's loop. Session i is seeded with S + i.
+ * Closed sessions are kept and reset for the next connection, so a busy
+ * server stops allocating. Listens on ADDR:P (127.0.0.1:7070 by default)
+ * or on the Unix socket PATH. Linux only; SIGINT or SIGTERM prints the
+ * totals and exits.
+ *
+ * With --park, "park" saves the session's game to a snapshot in DIR and
+ * hangs up, and "resume NAME" on any session of any server sharing DIR
+ * (same cave, levels and start distance) carries on with it, once: the
+ * first session to claim the snapshot has it.
+ *
+ * With --metrics, every command is timed from its line to its reply and
+ * the counters and latency histograms (wump_metrics.h) are written to
+ * FILE on exit and on SIGUSR1; JSON if FILE ends in ".json".
+ *
+ * --safe-levels and --min-enemy-distance only deal layouts that pass those
+ * rules (wump_levelgen.h). A pool of worker threads finds them ahead of
+ * time and keeps N (--pool, 256 by default) ready for each level, so a
+ * session starting a level pops one instead of searching. Pooled layouts
+ * do not follow from --seed.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "wump_engine.h"
+#include "wump_dialog.h"
+#include "wump_levelgen.h"
+#include "wump_metrics.h"
+#include "wump_snapshot.h"
+#include "wump_text.h"
+using namespace std;
+
+const char* PROMPT = ">>> ";
+const size_t MAX_LINE = 256;        // longer input without a newline closes the session
+const size_t MAX_PENDING = 1 << 16; // so does a client that sends but never reads
+const int MAX_EPOLL_EVENTS = 256;
+
+struct ServerOptions {
+    string host = "127.0.0.1";
+    int port = 7070;
+    string unixPath;
+    int threads = 0;
+    uint64_t seed = 1;
+    CaveSpec caveSpec;
+    int minDistance = 1;
+    const LevelTable* levels = &LevelTable::Default();
+    string parkDir;
+    string metricsPath;
+    LevelRules rules;
+    bool checkLevels = false;
+    size_t poolSize = 256;
+    LevelPool* pool = nullptr;      // set when checkLevels
+};
+
+// totals across reactors
+atomic<long> sessionsOpen(0);
+atomic<long> sessionsPeak(0);
+atomic<long> sessionsServed(0);
+atomic<long> turnsPlayed(0);
+atomic<uint64_t> nextSession(0);
+volatile sig_atomic_t stopping = 0;
+
+void OnSignal(int) {
+    stopping = 1;
+}
+
+// One connection's game; all the per-session state there is.
+struct Session {
+    int fd;
+    Game game;
+    Dialog dialog;      // the game's script, waiting for the next line
+    string in;          // bytes received, up to the last full line
+    string out;         // bytes not yet written
+    bool closing;       // close once out is written
+    bool wantWrite;     // EPOLLOUT is armed
+
+    // conx
+    Session(const Cave& cave, const LevelTable& levels, int minDistance)
+        : fd(-1), game(cave, levels), closing(false), wantWrite(false) {
+        game.SetMinStartDistance(minDistance);
+        in.reserve(MAX_LINE);
+    }
+};
+
+// What the session waits for next
+void ShowPrompt(const Level& level, string& out) {
+    if (level.Phase() == LevelPhase::AwaitingReplay)
+        out += "Would you like to replay the same level? Enter replay or quit.\n";
+    out += PROMPT;
+}
+
+// Parked games are named by 16 hex digits, hard to guess and safe as a
+// file name whichever server process parked them
+string ParkName(uint64_t salt) {
+    uint64_t x = salt ^ uint64_t(chrono::steady_clock::now().time_since_epoch().count())
+               ^ uint64_t(getpid()) << 32;
+    static const char hex[] = "0123456789abcdef";
+    uint64_t bits = Rng::Mix(x);
+    string name(16, '0');
+    for (int i = 0; i < 16; i++)
+        name[i] = hex[(bits >> (4 * i)) & 15];
+    return name;
+}
+
+bool IsParkName(const string& name) {
+    return name.size() == 16 && name.find_first_not_of("0123456789abcdef") == string::npos;
+}
+
+string ParkPath(const ServerOptions& options, const string& name) {
+    return options.parkDir + "/" + name + ".snap";
+}
+
+// One session's game from start to end, suspended while it waits for a
+// command; the levels in order until the player quits or wins. With
+// --park, "park" saves the game and hangs up, and "resume NAME" carries
+// on with a parked game, from this server or another one.
+Dialog PlaySession(Session& session, const ServerOptions& options) {
+    Game& game = session.game;
+    string& out = session.out;
+    string line;
+    string_view word, arg;     // in line
+    bool resumed = false;
+    out += "Welcome to Wump.2\n";
+    for (;;) {
+        Level& level = game.CurrentLevel();
+        StepResult step;
+        if (resumed && level.Phase() != LevelPhase::Over) {
+            step = level.Look();
+        } else {
+            out += "Loading level ";
+            out += to_string(level.LevelNum());
+            out += " ...\n";
+            if (options.pool) {
+                try {
+                    options.pool->Prepare(level);
+                } catch (const exception& e) {
+                    // the pool gave up on this level; the server carries on
+                    cerr << "wump_server: " << e.what() << endl;
+                    out += "Cannot load level " + to_string(level.LevelNum()) + ".\n";
+                    co_return;
+                }
+            }
+            step = level.Start();
+        }
+        resumed = false;
+        DescribeEvents(level, step, out);
+        while (level.Phase() != LevelPhase::Over) {
+            ShowPrompt(level, out);
+            line = co_await Dialog::Input();
+            SplitCommand(line, word, arg);
+            if (!options.parkDir.empty() && word == "park") {
+                string name = ParkName(uint64_t(reinterpret_cast<uintptr_t>(&session)));
+                if (SaveSnapshot(game, ParkPath(options, name))) {
+                    out += "Parked as " + name + ". Enter resume " + name + " to carry on.\n";
+                    co_return;
+                }
+                out += "Cannot park the game.\n";
+                continue;
+            }
+            if (!options.parkDir.empty() && word == "resume") {
+                string name(arg);
+                if (!IsParkName(name)) {
+                    out += "No parked game " + name + ".\n";
+                    continue;
+                }
+                // a game resumes once: whichever session renames it away
+                // first has it, and the others find it gone
+                string parked = ParkPath(options, name);
+                string claimed = parked + "." + ParkName(uint64_t(reinterpret_cast<uintptr_t>(&session)));
+                if (rename(parked.c_str(), claimed.c_str()) != 0) {
+                    out += "No parked game " + name + ".\n";
+                    continue;
+                }
+                try {
+                    LoadSnapshot(game, claimed);
+                } catch (const exception& e) {
+                    rename(claimed.c_str(), parked.c_str());   // leave it as it was
+                    out += "Cannot resume " + name + ": " + e.what() + "\n";
+                    continue;
+                }
+                unlink(claimed.c_str());
+                out += "Resumed " + name + " at level " + to_string(game.CurrentLevelNum()) + ".\n";
+                resumed = true;
+                break;
+            }
+            Action action;
+            if (!ParseCommand(level, word, arg, action)) {
+                out += "Invalid choice. Please try again.\n";
+                continue;
+            }
+            step = level.Step(action);
+            turnsPlayed.fetch_add(1, memory_order_relaxed);
+            DescribeEvents(level, step, out);
+        }
+        if (resumed)
+            continue;
+
+        const LevelResult& result = level.Result();
+        if (game.RecordResult(result)) {
+            out += "You won the game!\n";
+            co_return;
+        }
+        if (!result.killedEnemy) {
+            out += "Quitting game.\n";
+            co_return;
+        }
+        out += "You beat the level and advanced to the next one!\n";
+    }
+}
+
+void SetNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// One event loop: its own epoll set and sessions, sharing only the
+// listening socket and the read-only cave and levels.
+class Reactor {
+private:
+    int epollFd;
+    int listenFd;
+    int reserveFd;              // given up to turn a connection away when out of fds
+    bool isTcp;
+    const Cave& cave;
+    const ServerOptions& options;
+    vector<Session*> spare;     // closed sessions, kept for reuse
+    vector<Session*> closed;    // closed during this batch of events
+
+    void Accept();
+    void Open(int fd);
+    void Close(Session*);
+    void Read(Session*);
+    void Write(Session*);
+    void Watch(Session*);
+
+public:
+    Reactor(int listenFd, bool isTcp, const Cave&, const ServerOptions&);
+    ~Reactor();
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+    void Run();
+};
+
+// conx
+Reactor::Reactor(int lfd, bool tcp, const Cave& c, const ServerOptions& o)
+    : epollFd(epoll_create1(EPOLL_CLOEXEC)), listenFd(lfd), isTcp(tcp), cave(c), options(o) {
+    reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (epollFd < 0)
+        throw runtime_error(string("epoll_create1: ") + strerror(errno));
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;   // one reactor wakes per connection
+    ev.data.ptr = nullptr;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev) < 0)
+        throw runtime_error(string("epoll_ctl: ") + strerror(errno));
+}
+
+Reactor::~Reactor() {
+    for (Session* session : spare)
+        delete session;
+    for (Session* session : closed)
+        delete session;
+    if (reserveFd >= 0)
+        close(reserveFd);
+    close(epollFd);
+}
+
+void Reactor::Run() {
+    epoll_event events[MAX_EPOLL_EVENTS];
+    while (!stopping) {
+        int n = epoll_wait(epollFd, events, MAX_EPOLL_EVENTS, 500);
+        for (int i = 0; i < n; i++) {
+            Session* session = static_cast<Session*>(events[i].data.ptr);
+            if (!session) {
+                Accept();
+                continue;
+            }
+            if (session->fd < 0)
+                continue;       // closed earlier in this batch
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                Read(session);
+            if (session->fd >= 0 && (events[i].events & EPOLLOUT))
+                Write(session);
+        }
+        // only now can no event of this batch still point at them
+        spare.insert(spare.end(), closed.begin(), closed.end());
+        closed.clear();
+    }
+}
+
+void Reactor::Accept() {
+    for (;;) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0 && (errno == EMFILE || errno == ENFILE) && reserveFd >= 0) {
+            // the connection stays queued, and the listen fd readable, until
+            // taken: free the reserve fd to take it and hang up on it
+            cerr << "wump_server: out of file descriptors, turning a connection away" << endl;
+            close(reserveFd);
+            fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0)
+                close(fd);
+            reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return;
+            continue;
+        }
+        if (fd < 0)
+            return;     // EAGAIN: another reactor got it, or none left
+        if (isTcp) {
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+        Open(fd);
+    }
+}
+
+void Reactor::Open(int fd) {
+    Session* session;
+    if (spare.empty()) {
+        // main() built every level once already, so this only fails for
+        // want of memory; drop the one connection, not the reactor
+        try {
+            session = new Session(cave, *options.levels, options.minDistance);
+        } catch (const exception& e) {
+            cerr << "wump_server: " << e.what() << endl;
+            close(fd);
+            return;
+        }
+    } else {
+        session = spare.back();
+        spare.pop_back();
+        session->game.Reset();
+    }
+    session->fd = fd;
+    session->closing = false;
+    session->wantWrite = false;
+    session->in.clear();
+    session->out.clear();
+
+    uint64_t id = nextSession.fetch_add(1);
+    session->game.Seed(options.seed + id);
+    long now = sessionsOpen.fetch_add(1) + 1;
+    long peak = sessionsPeak.load();
+    while (now > peak && !sessionsPeak.compare_exchange_weak(peak, now)) {
+    }
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = session;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        Close(session);
+        return;
+    }
+    session->dialog = PlaySession(*session, options);
+    session->dialog.Start();
+    Write(session);
+}
+
+void Reactor::Close(Session* session) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, session->fd, nullptr);
+    close(session->fd);
+    session->fd = -1;
+    if (reserveFd < 0)
+        reserveFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    session->dialog = Dialog();     // its frame goes back to the pool
+    closed.push_back(session);
+    sessionsOpen.fetch_sub(1);
+    sessionsServed.fetch_add(1);
+}
+
+void Reactor::Read(Session* session) {
+    char buffer[4096];
+    for (;;) {
+        ssize_t n = read(session->fd, buffer, sizeof(buffer));
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+            Close(session);     // hung up
+            return;
+        }
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        // commands after the one that ends the game are ignored
+        for (ssize_t i = 0; i < n && !session->closing; i++) {
+            char c = buffer[i];
+            if (c == '\n') {
+                MetricsTimer timer(Timing::Turn);
+                session->dialog.Resume(session->in);
+                session->in.clear();
+                session->closing = session->dialog.Done();
+                if (session->out.size() > MAX_PENDING) {
+                    Close(session);
+                    return;
+                }
+            } else if (c != '\r') {
+                if (session->in.size() == MAX_LINE) {
+                    Close(session);
+                    return;
+                }
+                session->in += c;
+            }
+        }
+        if (n < ssize_t(sizeof(buffer)))
+            break;
+    }
+    Write(session);
+}
+
+// Sends what it can; the rest waits for EPOLLOUT
+void Reactor::Write(Session* session) {
+    size_t sent = 0;
+    while (sent < session->out.size()) {
+        ssize_t n = send(session->fd, session->out.data() + sent, session->out.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN) {
+                Close(session);
+                return;
+            }
+            break;
+        }
+        sent += size_t(n);
+    }
+    session->out.erase(0, sent);
+    if (session->out.empty() && session->closing) {
+        Close(session);
+        return;
+    }
+    Watch(session);
+}
+
+// Arms EPOLLOUT while output is pending
+void Reactor::Watch(Session* session) {
+    bool want = !session->out.empty();
+    if (want == session->wantWrite)
+        return;
+    epoll_event ev = {};
+    ev.events = want ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    ev.data.ptr = session;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, session->fd, &ev);
+    session->wantWrite = want;
+}
+
+// Lets one process hold as many connections as the hard limit allows
+void RaiseFileLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int Listen(const ServerOptions& options) {
+    int fd;
+    if (!options.unixPath.empty()) {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (options.unixPath.size() >= sizeof(addr.sun_path))
+            throw invalid_argument("socket path too long: " + options.unixPath);
+        strcpy(addr.sun_path, options.unixPath.c_str());
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        unlink(options.unixPath.c_str());
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+            throw runtime_error("cannot bind " + options.unixPath + ": " + strerror(errno));
+    } else {
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(uint16_t(options.port));
+        if (inet_pton(AF_INET, options.host.c_str(), &addr.sin_addr) != 1)
+            throw invalid_argument("bad address " + options.host);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int on = 1;
+        if (fd >= 0)
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+            throw runtime_error("cannot bind " + options.host + ":" + to_string(options.port) + ": " + strerror(errno));
+    }
+    if (listen(fd, SOMAXCONN) < 0)
+        throw runtime_error(string("listen: ") + strerror(errno));
+    SetNonBlocking(fd);
+    return fd;
+}
+
+int main(int argc, char* argv[]) {
+    ServerOptions options;
+    const char* levelsPath = nullptr;
+    LevelTable loaded;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--port") == 0 && hasValue) {
+            options.port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--host") == 0 && hasValue) {
+            options.host = argv[++i];
+        } else if (strcmp(argv[i], "--unix") == 0 && hasValue) {
+            options.unixPath = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--min-distance") == 0 && hasValue) {
+            options.minDistance = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--safe-levels") == 0) {
+            options.rules.safeWeapon = true;
+            options.checkLevels = true;
+        } else if (strcmp(argv[i], "--min-enemy-distance") == 0 && hasValue) {
+            options.rules.minEnemyDistance = atoi(argv[++i]);
+            options.checkLevels = true;
+        } else if (strcmp(argv[i], "--pool") == 0 && hasValue) {
+            options.poolSize = size_t(atol(argv[++i]));
+        } else if (strcmp(argv[i], "--levels") == 0 && hasValue) {
+            levelsPath = argv[++i];
+        } else if (strcmp(argv[i], "--park") == 0 && hasValue) {
+            options.parkDir = argv[++i];
+        } else if (strcmp(argv[i], "--metrics") == 0 && hasValue) {
+            options.metricsPath = argv[++i];
+        } else if (strcmp(argv[i], "--cave") == 0 && hasValue) {
+            if (!ParseCaveSpec(argv[++i], &options.caveSpec)) {
+                cerr << "wump_server: bad cave " << argv[i] << endl;
+                return 2;
+            }
+        } else {
+            cerr << "usage: wump_server [--port P] [--host ADDR] [--unix PATH] [--threads T] "
+                 << "[--seed S] [--cave SPEC] [--levels FILE] [--min-distance D] [--park DIR] "
+                 << "[--metrics FILE] [--safe-levels] [--min-enemy-distance D] [--pool N]" << endl;
+            return 2;
+        }
+    }
+    if (options.threads < 1)
+        options.threads = int(thread::hardware_concurrency());
+    if (options.threads < 1)
+        options.threads = 1;
+
+    Cave cave = Cave::Dodecahedron();
+    int listenFd;
+    vector<Reactor*> reactors;
+    unique_ptr<LevelPool> pool;
+    // before the pool's threads start, so they block SIGUSR1 too
+    if (!options.metricsPath.empty()) {
+        Metrics::EnableTiming();
+        Metrics::DumpOnSignal(options.metricsPath);
+    }
+    try {
+        cave = Cave::Build(options.caveSpec);
+        if (levelsPath) {
+            loaded = LevelTable::Load(levelsPath);
+            options.levels = &loaded;
+        }
+        // every level, so one the cave cannot hold fails here rather than
+        // in a reactor when the first player connects
+        Game probe(cave, *options.levels);
+        probe.SetMinStartDistance(options.minDistance);
+        if (options.checkLevels) {
+            pool = make_unique<LevelPool>(cave, *options.levels, options.rules, options.minDistance,
+                                          options.poolSize, 0, options.seed);
+            options.pool = pool.get();
+        }
+        RaiseFileLimit();
+        listenFd = Listen(options);
+        for (int t = 0; t < options.threads; t++)
+            reactors.push_back(new Reactor(listenFd, options.unixPath.empty(), cave, options));
+    } catch (const exception& e) {
+        cerr << "wump_server: " << e.what() << endl;
+        return 2;
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = OnSignal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    cerr << "wump_server: listening on "
+         << (options.unixPath.empty() ? options.host + ":" + to_string(options.port) : options.unixPath)
+         << " with " << options.threads << " reactors" << endl;
+    vector<thread> workers;
+    for (int t = 1; t < options.threads; t++)
+        workers.emplace_back(&Reactor::Run, reactors[t]);
+    reactors[0]->Run();
+    for (thread& worker : workers)
+        worker.join();
+
+    close(listenFd);
+    if (!options.unixPath.empty())
+        unlink(options.unixPath.c_str());
+    cout << "sessions served " << sessionsServed.load() + sessionsOpen.load() << endl;
+    cout << "peak sessions   " << sessionsPeak.load() << endl;
+    cout << "turns           " << turnsPlayed.load() << endl;
+    if (pool)
+        cout << "levels pooled   " << pool->Generated() << endl;
+    if (!options.metricsPath.empty() && !Metrics::Dump(options.metricsPath))
+        cerr << "wump_server: cannot write " << options.metricsPath << endl;
+    for (Reactor* reactor : reactors)
+        delete reactor;
+    return 0;
+}
@@ -0,0 +1,506 @@
+/*
+ * wump_sim - plays seeded Wump.2 games headless and reports games/sec
+ *
+ * usage: wump_sim [--games N] [--seed S] [--agent NAME] [--replays R]
+ *                 [--max-turns T] [--cave SPEC] [--min-distance D]
+ *                 [--threads T] [--record FILE] [--levels FILE]
+ *                 [--metrics FILE] [--safe-levels] [--min-enemy-distance D]
+ *                 [--agents NAME[:R],NAME[:R],...]
+ *
+ * Game i is seeded with S + i, so any single game can be played again
+ * by running with --seed S+i --games 1, and the totals do not depend on
+ * --threads. A level that runs past --max-turns actions is quit. --cave
+ * picks the map, see wump_cave.h. --min-distance keeps everything at
+ * least D tunnels from the start room. --record writes every level played
+ * to a turn log for wump_replay. --levels plays the levels of a level
+ * definition file (see wump_levels.txt) instead of the built-in ones.
+ * --metrics times every Step() and writes the engine's counters and the
+ * turn histogram (wump_metrics.h) to FILE at the end and on SIGUSR1.
+ * --safe-levels only plays levels where the weapon and a shot at the
+ * enemy can be reached without crossing a hazard, and --min-enemy-distance
+ * only those with the enemy at least D tunnels away (wump_levelgen.h);
+ * both still come out the same for the same seed.
+ *
+ * --agents runs a tournament instead: every game is played by each agent
+ * in the list (NAME:R gives that one R replays instead of --replays), on
+ * the same seed, so each level deals the same for all of them. Games go
+ * to one thread per core unless --threads says otherwise, through a work
+ * stealing queue (wump_steal.h), since one long game would otherwise hold
+ * up a fixed share. Each agent's win rate and turns per game are printed
+ * with 95% intervals, and every agent's wins against the first agent's
+ * on the same seeds, a paired difference that needs far fewer games to
+ * tell two agents (or two versions of a level file) apart. The totals do
+ * not depend on --threads or on which thread played what.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "wump_engine.h"
+#include "wump_agents.h"
+#include "wump_levelgen.h"
+#include "wump_log.h"
+#include "wump_metrics.h"
+#include "wump_steal.h"
+using namespace std;
+
+struct SimStats {
+    long games = 0;
+    long won = 0;
+    long levelsCleared = 0;
+    long deaths = 0;
+    long turns = 0;
+    long timeouts = 0;
+
+    void Add(const SimStats& other) {
+        games += other.games;
+        won += other.won;
+        levelsCleared += other.levelsCleared;
+        deaths += other.deaths;
+        turns += other.turns;
+        timeouts += other.timeouts;
+    }
+};
+
+// One entry of --agents
+struct Entrant {
+    string name;
+    int replays;
+};
+
+// An entrant's totals, kept as integers so they add up the same in any order
+struct EntrantStats {
+    SimStats sim;
+    long turnsSq = 0;           // sum of turns per game squared
+    long diff = 0, diffSq = 0;  // won minus the first entrant's won, per game
+
+    void Add(const EntrantStats& other) {
+        sim.Add(other.sim);
+        turnsSq += other.turnsSq;
+        diff += other.diff;
+        diffSq += other.diffSq;
+    }
+};
+
+struct SimOptions {
+    long games = 10000;
+    uint64_t seed = 1;
+    string agentName = "random";
+    int replays = 0;
+    int maxTurns = 1000;
+    CaveSpec caveSpec;
+    int minDistance = 1;
+    int threads = 1;
+    string recordPath;
+    string metricsPath;
+    bool checkLevels = false;
+    LevelRules rules;
+    vector<Entrant> entrants;     // --agents
+    const LevelTable* levels = &LevelTable::Default();
+};
+
+// Plays one whole game: all levels in order until the agent quits,
+// gives up after dying, or beats the last level. Levels are appended to
+// log unless it is null, and checked by generator unless it is null. The
+// game is reset first, so one Game serves a whole run without allocating.
+void PlayGame(Agent& agent, Game& game, uint64_t seed, const SimOptions& options,
+              SimStats& stats, TurnLog* log, LevelGenerator* generator) {
+    game.Reset();
+    game.Seed(seed);
+    uint64_t agentSeed = seed;
+    agent.Seed(Rng::Mix(agentSeed));
+    bool won = false;
+    bool over = false;
+
+    while (!over && !won) {
+        Level& level = game.CurrentLevel();
+        if (generator)
+            generator->Prepare(level);
+        StepResult step = level.Start();
+        agent.BeginLevel(level, step);
+        if (log)
+            log->BeginLevel(level, step);
+        int turns = 0;
+        while (step.state.phase != LevelPhase::Over) {
+            Action action = {ActionType::Quit, -1};
+            if (turns == options.maxTurns) {
+                stats.timeouts++;
+            } else {
+                if (step.state.phase == LevelPhase::AwaitingReplay)
+                    stats.deaths++;
+                action = agent.Act(level, step);
+                turns++;
+            }
+            {
+                MetricsTimer timer(Timing::Turn);
+                step = level.Step(action);
+            }
+            if (log)
+                log->Step(action, step);
+        }
+        stats.turns += turns;
+
+        const LevelResult& result = level.Result();
+        if (log)
+            log->EndLevel(result);
+        if (result.killedEnemy)
+            stats.levelsCleared++;
+        else
+            over = true;
+        won = game.RecordResult(result);
+    }
+    stats.games++;
+    if (won)
+        stats.won++;
+}
+
+// Worker w plays games w, w + threads, w + 2 * threads, ...
+// Anything thrown stops the worker and is left in error for main().
+void RunWorker(int w, const Cave& cave, const SimOptions& options, SimStats& stats,
+               TurnLog& log, string& error) {
+    try {
+        unique_ptr<Agent> agent = MakeAgent(options.agentName, options.replays);
+        Game game(cave, *options.levels);
+        game.SetMinStartDistance(options.minDistance);
+        LevelGenerator generator(cave, options.rules);
+        bool record = !options.recordPath.empty();
+        for (long i = w; i < options.games; i += options.threads)
+            PlayGame(*agent, game, options.seed + i, options, stats, record ? &log : nullptr,
+                     options.checkLevels ? &generator : nullptr);
+    } catch (const exception& e) {
+        error = e.what();
+    }
+}
+
+// Plays game after game from the queue, each one by every entrant in turn
+void RunTournamentWorker(int w, const Cave& cave, const SimOptions& options, StealingQueue& queue,
+                         vector<EntrantStats>& stats, string& error) {
+    try {
+        vector<unique_ptr<Agent>> agents;
+        for (const Entrant& entrant : options.entrants)
+            agents.push_back(MakeAgent(entrant.name, entrant.replays));
+        Game game(cave, *options.levels);
+        game.SetMinStartDistance(options.minDistance);
+        LevelGenerator generator(cave, options.rules);
+        long i;
+        while (queue.Next(w, i)) {
+            long firstWon = 0;
+            for (size_t a = 0; a < agents.size(); a++) {
+                SimStats& sim = stats[a].sim;
+                long won = sim.won, turns = sim.turns;
+                PlayGame(*agents[a], game, options.seed + i, options, sim, nullptr,
+                         options.checkLevels ? &generator : nullptr);
+                won = sim.won - won;
+                turns = sim.turns - turns;
+                stats[a].turnsSq += turns * turns;
+                if (a == 0)
+                    firstWon = won;
+                stats[a].diff += won - firstWon;
+                stats[a].diffSq += (won - firstWon) * (won - firstWon);
+            }
+        }
+    } catch (const exception& e) {
+        error = e.what();
+    }
+}
+
+// Reports what any worker threw; false if one did
+static bool CheckErrors(const vector<string>& errors) {
+    for (const string& error : errors) {
+        if (!error.empty()) {
+            cerr << "wump_sim: " << error << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// 95% interval of a rate: Wilson's, which holds up near 0 and 1
+static void WilsonInterval(long hits, long n, double& low, double& high) {
+    const double z = 1.96;
+    if (n == 0) {
+        low = 0;
+        high = 1;
+        return;
+    }
+    double p = double(hits) / n;
+    double centre = (p + z * z / (2 * n)) / (1 + z * z / n);
+    double half = z * sqrt(p * (1 - p) / n + z * z / (4.0 * n * n)) / (1 + z * z / n);
+    low = max(0.0, centre - half);
+    high = min(1.0, centre + half);
+}
+
+// Half the 95% interval of a mean, from the sums of the values and their squares
+static double HalfInterval(double sum, double sumSq, long n) {
+    if (n < 2)
+        return 0;
+    double mean = sum / n;
+    double var = max(0.0, (sumSq - n * mean * mean) / (n - 1));
+    return 1.96 * sqrt(var / n);
+}
+
+int RunTournament(const Cave& cave, const SimOptions& options) {
+    StealingQueue queue(options.games, options.threads);
+    vector<vector<EntrantStats>> perThread(options.threads, vector<EntrantStats>(options.entrants.size()));
+    vector<string> errors(options.threads);
+    vector<thread> workers;
+    auto begin = chrono::steady_clock::now();
+    for (int w = 1; w < options.threads; w++)
+        workers.emplace_back(RunTournamentWorker, w, cref(cave), cref(options), ref(queue), ref(perThread[w]),
+                             ref(errors[w]));
+    RunTournamentWorker(0, cave, options, queue, perThread[0], errors[0]);
+    for (thread& worker : workers)
+        worker.join();
+    if (!CheckErrors(errors))
+        return 1;
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    vector<EntrantStats> stats(options.entrants.size());
+    for (const vector<EntrantStats>& counts : perThread) {
+        for (size_t a = 0; a < stats.size(); a++)
+            stats[a].Add(counts[a]);
+    }
+
+    long games = options.games;
+    cout << "cave            " << CaveSpecName(options.caveSpec) << " (" << cave.NumRooms() << " rooms)" << endl;
+    cout << "threads         " << options.threads << endl;
+    cout << "games           " << games << " per agent, seeds " << options.seed << " to "
+         << options.seed + games - 1 << endl;
+    cout << "steals          " << queue.Steals() << endl;
+    cout << endl;
+    auto label = [&](size_t a) {
+        return options.entrants[a].name + ":" + to_string(options.entrants[a].replays);
+    };
+    cout << left << setw(12) << "agent" << right << setw(8) << "won" << setw(24) << "win rate (95%)"
+         << setw(18) << "turns/game (95%)" << setw(10) << "cleared" << setw(10) << "deaths"
+         << setw(10) << "timeouts" << setw(26) << "won - " + label(0) + " (95%)" << endl;
+    for (size_t a = 0; a < stats.size(); a++) {
+        const SimStats& sim = stats[a].sim;
+        double low, high;
+        WilsonInterval(sim.won, games, low, high);
+        double winRate = games ? double(sim.won) / games : 0;
+        double turns = games ? double(sim.turns) / games : 0;
+
+        ostringstream rate, perGame, paired;
+        rate << fixed << setprecision(4) << winRate << " " << low << "-" << high;
+        perGame << fixed << setprecision(1) << turns << " +- "
+                << HalfInterval(double(sim.turns), double(stats[a].turnsSq), games);
+        if (a == 0) {
+            paired << "-";
+        } else {
+            double diff = games ? double(stats[a].diff) / games : 0;
+            paired << showpos << fixed << setprecision(4) << diff << noshowpos << " +- "
+                   << HalfInterval(double(stats[a].diff), double(stats[a].diffSq), games);
+        }
+        cout << left << setw(12) << label(a) << right << setw(8) << sim.won << setw(24) << rate.str()
+             << setw(18) << perGame.str() << setw(10) << sim.levelsCleared << setw(10) << sim.deaths
+             << setw(10) << sim.timeouts << setw(26) << paired.str() << endl;
+    }
+    cout << endl;
+    long played = games * long(stats.size());
+    cout << "seconds         " << secs << endl;
+    cout << "games/sec       " << (secs > 0 ? played / secs : 0) << endl;
+    if (!options.metricsPath.empty() && !Metrics::Dump(options.metricsPath)) {
+        cerr << "wump_sim: cannot write " << options.metricsPath << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// NAME[:REPLAYS],... as given to --agents; false if it does not parse
+static bool ParseEntrants(const string& list, int replays, vector<Entrant>& entrants) {
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == string::npos)
+            comma = list.size();
+        string item = list.substr(start, comma - start);
+        Entrant entrant = {item, replays};
+        size_t colon = item.find(':');
+        if (colon != string::npos) {
+            entrant.name = item.substr(0, colon);
+            char* end;
+            long r = strtol(item.c_str() + colon + 1, &end, 10);
+            if (*end || end == item.c_str() + colon + 1 || r < 0)
+                return false;
+            entrant.replays = int(r);
+        }
+        if (entrant.name.empty())
+            return false;
+        entrants.push_back(entrant);
+        start = comma + 1;
+    }
+    return !entrants.empty();
+}
+
+int main(int argc, char* argv[]) {
+    SimOptions options;
+    const char* levelsPath = nullptr;
+    const char* agentList = nullptr;
+    bool threadsGiven = false;
+    LevelTable loaded;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--games") == 0 && hasValue) {
+            options.games = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--agent") == 0 && hasValue) {
+            options.agentName = argv[++i];
+        } else if (strcmp(argv[i], "--replays") == 0 && hasValue) {
+            options.replays = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-turns") == 0 && hasValue) {
+            options.maxTurns = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--min-distance") == 0 && hasValue) {
+            options.minDistance = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--safe-levels") == 0) {
+            options.checkLevels = true;
+            options.rules.safeWeapon = true;
+        } else if (strcmp(argv[i], "--min-enemy-distance") == 0 && hasValue) {
+            options.checkLevels = true;
+            options.rules.minEnemyDistance = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            options.threads = atoi(argv[++i]);
+            threadsGiven = true;
+        } else if (strcmp(argv[i], "--agents") == 0 && hasValue) {
+            agentList = argv[++i];
+        } else if (strcmp(argv[i], "--levels") == 0 && hasValue) {
+            levelsPath = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && hasValue) {
+            options.recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--metrics") == 0 && hasValue) {
+            options.metricsPath = argv[++i];
+        } else if (strcmp(argv[i], "--cave") == 0 && hasValue) {
+            if (!ParseCaveSpec(argv[++i], &options.caveSpec)) {
+                cerr << "wump_sim: bad cave " << argv[i] << endl;
+                return 2;
+            }
+        } else {
+            cerr << "usage: wump_sim [--games N] [--seed S] [--agent NAME] "
+                 << "[--replays R] [--max-turns T] [--cave SPEC] [--min-distance D] "
+                 << "[--threads T] [--record FILE] [--levels FILE] [--metrics FILE] "
+                 << "[--safe-levels] [--min-enemy-distance D] [--agents NAME[:R],...]" << endl;
+            return 2;
+        }
+    }
+    if (agentList) {
+        if (!ParseEntrants(agentList, options.replays, options.entrants)) {
+            cerr << "wump_sim: bad agent list " << agentList << endl;
+            return 2;
+        }
+        for (const Entrant& entrant : options.entrants) {
+            if (!MakeAgent(entrant.name, entrant.replays)) {
+                cerr << "wump_sim: unknown agent " << entrant.name << endl;
+                return 2;
+            }
+        }
+        if (!options.recordPath.empty()) {
+            cerr << "wump_sim: --record takes a single --agent" << endl;
+            return 2;
+        }
+        if (!threadsGiven)
+            options.threads = 0;    // every core
+    }
+    if (options.threads < 1)
+        options.threads = int(thread::hardware_concurrency());
+    if (options.threads < 1)
+        options.threads = 1;
+
+    unique_ptr<Agent> agent = MakeAgent(options.agentName, options.replays);
+    if (!agent) {
+        cerr << "wump_sim: unknown agent " << options.agentName << endl;
+        return 2;
+    }
+
+    Cave cave = Cave::Dodecahedron();
+    try {
+        cave = Cave::Build(options.caveSpec);
+        if (levelsPath) {
+            loaded = LevelTable::Load(levelsPath);
+            options.levels = &loaded;
+        }
+        // every level, so one the cave cannot hold fails here rather than in a worker
+        Game probe(cave, *options.levels);
+        probe.SetMinStartDistance(options.minDistance);
+        if (options.checkLevels) {
+            // throws now if some level can never meet the rules
+            LevelGenerator generator(cave, options.rules);
+            for (int lev = 0; lev < options.levels->NumLevels(); lev++) {
+                Level check(lev, cave, *options.levels);
+                check.SetMinStartDistance(options.minDistance);
+                generator.Prepare(check);
+            }
+        }
+    } catch (const exception& e) {
+        cerr << "wump_sim: " << e.what() << endl;
+        return 2;
+    }
+
+    if (!options.metricsPath.empty()) {
+        Metrics::EnableTiming();
+        Metrics::DumpOnSignal(options.metricsPath);
+    }
+
+    if (!options.entrants.empty())
+        return RunTournament(cave, options);
+
+    vector<SimStats> perThread(options.threads);
+    vector<string> errors(options.threads);
+    vector<TurnLog> logs(options.threads);
+    vector<thread> workers;
+    auto begin = chrono::steady_clock::now();
+    for (int w = 1; w < options.threads; w++)
+        workers.emplace_back(RunWorker, w, cref(cave), cref(options), ref(perThread[w]), ref(logs[w]),
+                             ref(errors[w]));
+    RunWorker(0, cave, options, perThread[0], logs[0], errors[0]);
+    for (thread& worker : workers)
+        worker.join();
+    if (!CheckErrors(errors))
+        return 1;
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    if (!options.recordPath.empty()) {
+        // one log: the workers' records back to back under a single header
+        ofstream out(options.recordPath, ios::binary | ios::trunc);
+        out.write(WUMP_LOG_MAGIC, sizeof(WUMP_LOG_MAGIC));
+        for (const TurnLog& log : logs) {
+            if (log.Data().size() > sizeof(WUMP_LOG_MAGIC))
+                out.write(log.Data().data() + sizeof(WUMP_LOG_MAGIC), log.Data().size() - sizeof(WUMP_LOG_MAGIC));
+        }
+        if (!out) {
+            cerr << "wump_sim: cannot write " << options.recordPath << endl;
+            return 1;
+        }
+    }
+
+    SimStats stats;
+    for (const SimStats& s : perThread)
+        stats.Add(s);
+
+    cout << "agent           " << agent->Name() << endl;
+    cout << "cave            " << CaveSpecName(options.caveSpec) << " (" << cave.NumRooms() << " rooms)" << endl;
+    cout << "threads         " << options.threads << endl;
+    cout << "games           " << stats.games << endl;
+    cout << "won             " << stats.won << endl;
+    cout << "levels cleared  " << stats.levelsCleared << endl;
+    cout << "deaths          " << stats.deaths << endl;
+    cout << "turns           " << stats.turns << endl;
+    cout << "timeouts        " << stats.timeouts << endl;
+    cout << "seconds         " << secs << endl;
+    cout << "games/sec       " << (secs > 0 ? stats.games / secs : 0) << endl;
+    cout << "turns/sec       " << (secs > 0 ? stats.turns / secs : 0) << endl;
+    if (!options.metricsPath.empty() && !Metrics::Dump(options.metricsPath)) {
+        cerr << "wump_sim: cannot write " << options.metricsPath << endl;
+        return 1;
+    }
+    return 0;
+}
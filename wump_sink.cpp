@@ -0,0 +1,41 @@
+/*
+ * Wump.2 - where a turn's output goes, see wump_sink.h
+ */
+
+#include "wump_sink.h"
+#include "wump_text.h"
+using namespace std;
+
+// conx
+TextSink::TextSink(ostream& stream) : out(stream) {
+    buffer.reserve(2 * kFlushAt);
+}
+
+TextSink::~TextSink() {
+    Flush();
+}
+
+void TextSink::Text(string_view text) {
+    buffer.append(text.data(), text.size());
+    if (buffer.size() >= kFlushAt)
+        Flush();
+}
+
+void TextSink::Events(const Level& level, const StepResult& step) {
+    DescribeEvents(level, step, buffer);
+    if (buffer.size() >= kFlushAt)
+        Flush();
+}
+
+void TextSink::Flush() {
+    if (!buffer.empty()) {
+        out.write(buffer.data(), streamsize(buffer.size()));
+        buffer.clear();
+    }
+    out.flush();
+}
+
+void EventSink::Events(const Level& level, const StepResult& step) {
+    for (int i = 0; i < step.numEvents; i++)
+        consume(level, step.events[i]);
+}
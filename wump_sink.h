@@ -0,0 +1,64 @@
+/*
+ * Wump.2 - where a turn's output goes
+ *
+ * A front end hands each turn's text and events to an OutputSink and
+ * calls Flush() before it waits for input, so a turn costs one write
+ * however many lines it prints. TextSink is the text of wump_text.h in
+ * one buffer; EventSink passes the events to a callback and drops the
+ * text, for tools that want them structured; NullSink drops everything,
+ * for headless runs.
+ */
+
+#ifndef WUMP_SINK_H
+#define WUMP_SINK_H
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "wump_engine.h"
+
+class OutputSink {
+public:
+    virtual ~OutputSink() {}
+    virtual void Text(std::string_view) = 0;
+    virtual void Events(const Level&, const StepResult&) = 0;
+    virtual void Flush() {}
+};
+
+// Buffers until Flush(), or until kFlushAt bytes are waiting
+class TextSink : public OutputSink {
+private:
+    static const size_t kFlushAt = 1 << 16;
+    std::ostream& out;
+    std::string buffer;
+
+public:
+    TextSink(std::ostream&);
+    ~TextSink();
+    void Text(std::string_view) override;
+    void Events(const Level&, const StepResult&) override;
+    void Flush() override;
+};
+
+// flush, if given, is what Flush() calls, e.g. to flush where consume writes
+class EventSink : public OutputSink {
+private:
+    std::function<void(const Level&, const Event&)> consume;
+    std::function<void()> flush;
+
+public:
+    EventSink(std::function<void(const Level&, const Event&)> consumer, std::function<void()> flusher = nullptr)
+        : consume(consumer), flush(flusher) {}
+    void Text(std::string_view) override {}
+    void Events(const Level&, const StepResult&) override;
+    void Flush() override { if (flush) flush(); }
+};
+
+class NullSink : public OutputSink {
+public:
+    void Text(std::string_view) override {}
+    void Events(const Level&, const StepResult&) override {}
+};
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * Wump.2 - game snapshots on disk, see wump_snapshot.h
+ */
+
+#include "wump_snapshot.h"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+using namespace std;
+
+// conx
+SnapshotFile::SnapshotFile() {
+    base = nullptr;
+    size = 0;
+}
+
+SnapshotFile::~SnapshotFile() {
+    Close();
+}
+
+void SnapshotFile::Close() {
+    if (base != nullptr) {
+        #ifdef _WIN32
+            delete[] base;
+        #else
+            munmap((void*)base, size);
+        #endif
+    }
+    base = nullptr;
+    size = 0;
+}
+
+bool SnapshotFile::Open(const string& path) {
+    Close();
+    #ifdef _WIN32
+        ifstream file(path, ios::binary | ios::ate);
+        if (!file.is_open())
+            return false;
+        size_t length = size_t(file.tellg());
+        unsigned char* data = new unsigned char[length];
+        file.seekg(0);
+        file.read((char*)data, length);
+        if (!file || length == 0) {
+            delete[] data;
+            return false;
+        }
+        base = data;
+        size = length;
+        return true;
+    #else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        size_t length = size_t(st.st_size);
+        void* data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            return false;
+        base = (const unsigned char*)data;
+        size = length;
+        return true;
+    #endif
+}
+
+// Written beside the target and renamed over it
+bool SaveSnapshot(const Game& game, const string& path) {
+    vector<char> data(game.SnapshotSize());
+    game.Save(data.data());
+    string temp = path + ".tmp";
+    {
+        ofstream file(temp, ios::binary | ios::trunc);
+        file.write(data.data(), streamsize(data.size()));
+        file.close();       // flushes: a full disk shows up here
+        if (!file) {
+            remove(temp.c_str());
+            return false;
+        }
+    }
+    #ifdef _WIN32
+        remove(path.c_str());   // rename does not replace on Windows
+    #endif
+    if (rename(temp.c_str(), path.c_str()) != 0) {
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+void LoadSnapshot(Game& game, const string& path) {
+    SnapshotFile file;
+    if (!file.Open(path))
+        throw runtime_error("cannot read snapshot " + path);
+    game.Restore(file.Data(), file.Size());
+}
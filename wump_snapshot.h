@@ -0,0 +1,50 @@
+/*
+ * Wump.2 - game snapshots on disk
+ *
+ * A snapshot is Game::Save() written out as is: a GameSnapshotHeader and
+ * each level's LevelSnapshot and rooms (see wump_engine.h), fixed layout,
+ * native byte order; 48 bytes, then 104 + 40 per classic level (more for
+ * levels that place more). Every room, the start positions
+ * PlayAgain() goes back to, the weapon and ammo, the phase and each
+ * level's generator state are in it, so a restored game plays on exactly
+ * as the saved one would have.
+ *
+ * Files are written to a temporary name and renamed into place, so a
+ * reader never sees half a snapshot, and are memory-mapped to restore.
+ * A snapshot only restores into a Game of the same cave, the same levels
+ * (as many of each thing) and the same start distance.
+ */
+
+#ifndef WUMP_SNAPSHOT_H
+#define WUMP_SNAPSHOT_H
+
+#include <cstddef>
+#include <string>
+#include "wump_engine.h"
+
+// A snapshot file mapped read-only (read into memory on Windows)
+class SnapshotFile {
+private:
+    const unsigned char* base;
+    size_t size;
+
+public:
+    SnapshotFile();
+    ~SnapshotFile();
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+    const void* Data() const { return base; }
+    size_t Size() const { return size; }
+};
+
+// false if the file cannot be written
+bool SaveSnapshot(const Game&, const std::string& path);
+
+// runtime_error if the file cannot be read, invalid_argument if it is
+// not a snapshot of a game like this one; the game is unchanged then
+void LoadSnapshot(Game&, const std::string& path);
+
+#endif
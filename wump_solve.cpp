@@ -0,0 +1,550 @@
+/*
+ * wump_solve - perfect-information win probability of a level by value iteration
+ *
+ * usage: wump_solve [--level L] [--cave SPEC] [--min-distance D]
+ *                   [--layouts K | --all | --layout P1,P2,W] [--seed S]
+ *                   [--threads T] [--epsilon E] [--levels FILE]
+ *                   [--policy FILE]
+ *
+ * The pits and the weapon never move, so each (pit, pit, weapon room)
+ * layout is its own Markov decision process over
+ *
+ *     player room, enemy room, bat rooms, weapon state (none / held + ammo)
+ *
+ * with the engine's transitions: the enemy moves with Enemy::pMove when
+ * an attack misses (down any tunnel, or the ones Enemy::moves picks),
+ * fights go to Weapon::pToHit, and the bats drop the player anywhere but
+ * room 0 and their rooms, then fly to a room without the enemy, the
+ * player or the other bats.
+ *
+ * The player sees everything, the layout included, so the result is a
+ * perfect-information upper bound on what any agent can win, not a
+ * measure of how hard the level plays. Such a player walks around every
+ * hazard to the weapon and attacks from next to the enemy, so the bound
+ * sits near 1 for every level and hardly moves with pMove or pToHit; it
+ * is no guide for tuning them. Play agents with wump_sim for that.
+ * Solving over what a player hears instead (a belief over the layouts
+ * that fit the warnings) is out of reach of this kind of sweep.
+ *
+ * --layout solves the one layout with pits P1 and P2 and the weapon in W,
+ * and --policy then writes its optimal action from every state to FILE,
+ * a line each:
+ *
+ *     player enemy bat1 bat2 weapon  move|attack|quit room  win
+ *
+ * where weapon is the weapon state and room is -1 for quit.
+ *
+ * A state packs into one integer, player room innermost:
+ *
+ *     key = (((weapon * n + bat2) * n + bat1) * n + enemy) * n + player
+ *
+ * so a move touches values n apart at most and an enemy step n * n apart.
+ * Values are swept in place (Gauss-Seidel) until no state changes by more
+ * than --epsilon, one weapon state at a time since ammo only runs down.
+ * Bats are kept with bat1 < bat2, which halves the sweep.
+ *
+ * Only levels with the classic counts (one enemy and weapon, two pits and
+ * bats) are solved; others are skipped.
+ *
+ * The level's win probability is the mean over layouts of the value of
+ * starting in room 0, averaged over every enemy and bat start the level's
+ * deck can deal. --all solves every layout; otherwise --layouts K of them
+ * are sampled and a 95% interval is printed. Layouts are shared out to
+ * --threads workers, each with its own tables. A layout of the classic
+ * cave takes about a tenth of a second on one core, so --all (2907 of
+ * them) takes minutes unless there are many cores.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "wump_engine.h"
+#include "wump_rng.h"
+using namespace std;
+
+const uint64_t MAX_STATES = 1u << 25;   // about 256 MB of values
+
+// the static part of a level: pits and where the weapon lies
+struct SolveLayout {
+    int pit1, pit2;
+    int weaponRoom;
+};
+
+// a level's rules as the solver needs them
+struct SolveRules {
+    const Cave* cave;
+    int n;
+    double pMove;
+    EnemyMove moves;
+    double pToHit;
+    bool isLimited;
+    int weaponStates;       // 0 = none, then 1 + ammo while held
+    int pickedUp;           // weapon state right after picking it up
+    vector<int> deck;       // rooms things can start in
+
+    bool CanAttack(int w) const { return w > 0 && (!isLimited || w > 1); }
+    double Fight(int w) const { return CanAttack(w) ? pToHit : 0.0; }
+    uint64_t NumStates() const { return uint64_t(weaponStates) * n * n * n * n; }
+};
+
+struct LayoutResult {
+    double win;             // from room 0, averaged over enemy and bat starts
+    int iterations;
+};
+
+// One worker's tables, reused from layout to layout
+class LayoutSolver {
+private:
+    const SolveRules& rules;
+    int n;
+    vector<double> value;       // by state key
+    vector<double> dropped;     // f: dropped in d, by ((w * n + other) * n + enemy) * n + d
+    vector<double> droppedSum;  // F: f summed over d = 1 .. n-1, by (w * n + other) * n + enemy
+    vector<uint8_t> pit;
+    int weaponRoom;
+
+    uint32_t Key(int p, int e, int b1, int b2, int w) const {
+        if (b1 > b2)
+            swap(b1, b2);
+        return uint32_t((((w * n + b2) * n + b1) * n + e) * n + p);
+    }
+    int PickUp(int room, int w) const {
+        return room == weaponRoom && w == 0 ? rules.pickedUp : w;
+    }
+    double Enter(int m, int e, int b1, int b2, int w) const;
+    double Snatched(int m, int e, int other, int w) const;
+    double Miss(int p, int e, int b1, int b2, int w) const;
+    double Best(int p, int e, int b1, int b2, int w, Action& choice) const;
+    void Drops(int w);
+
+public:
+    LayoutSolver(const SolveRules& r) : rules(r), n(r.n) {
+        value.resize(rules.NumStates());
+        dropped.resize(size_t(rules.weaponStates) * n * n * n);
+        droppedSum.resize(size_t(rules.weaponStates) * n * n);
+        pit.resize(n);
+    }
+    LayoutResult Solve(const SolveLayout&, double epsilon);
+    // the best action from every state of the last layout solved
+    void WritePolicy(ostream&);
+};
+
+// Walking into room m
+double LayoutSolver::Enter(int m, int e, int b1, int b2, int w) const {
+    if (m == e)
+        return rules.Fight(w);
+    w = PickUp(m, w);
+    if (m == b1)
+        return Snatched(m, e, b2, w);
+    if (m == b2)
+        return Snatched(m, e, b1, w);
+    if (pit[m])
+        return 0.0;
+    return value[Key(m, e, b1, b2, w)];
+}
+
+// The bats in room m grab the player: dropped anywhere in 1 .. n-1 but
+// m and other, each with the same chance
+double LayoutSolver::Snatched(int m, int e, int other, int w) const {
+    size_t base = (size_t(w) * n + other) * n + e;
+    double sum = droppedSum[base] - dropped[base * n + m] - dropped[base * n + other];
+    return sum / (n - 3);
+}
+
+// Attacking from p into any room but the enemy's; which one does not matter
+double LayoutSolver::Miss(int p, int e, int b1, int b2, int w) const {
+    if (rules.isLimited)
+        w--;
+    // startled: stays, or moves to a neighbor and maybe into the player
+    double stays = (1 - rules.pMove) * value[Key(p, e, b1, b2, w)];
+    if (rules.pMove == 0)
+        return stays;
+    const int* next = rules.cave->Neighbors(e);
+    int degree = rules.cave->Degree(e);
+    double moves = 0;
+    if (rules.moves == EnemyMove::Random) {
+        for (int j = 0; j < degree; j++)
+            moves += next[j] == p ? rules.Fight(w) : value[Key(p, next[j], b1, b2, w)];
+        return stays + rules.pMove * moves / degree;
+    }
+    // only the tunnels furthest from (nearest to) the player, evenly
+    int sign = rules.moves == EnemyMove::Away ? -1 : 1;
+    int best = numeric_limits<int>::max(), ties = 0;
+    for (int j = 0; j < degree; j++)
+        best = min(best, sign * rules.cave->Distance(next[j], p));
+    for (int j = 0; j < degree; j++) {
+        if (sign * rules.cave->Distance(next[j], p) != best)
+            continue;
+        moves += next[j] == p ? rules.Fight(w) : value[Key(p, next[j], b1, b2, w)];
+        ties++;
+    }
+    return stays + rules.pMove * moves / ties;
+}
+
+// The best action from a state and what it is worth; quitting is worth 0
+double LayoutSolver::Best(int p, int e, int b1, int b2, int w, Action& choice) const {
+    const Cave& cave = *rules.cave;
+    bool armed = rules.CanAttack(w);
+    double best = 0;
+    choice = {ActionType::Quit, -1};
+    if (armed && cave.IsAdjacent(p, e)) {
+        choice = {ActionType::Attack, e};   // shoot it
+        return 1.0;
+    }
+    const int* next = cave.Neighbors(p);
+    int degree = cave.Degree(p);
+    for (int j = 0; j < degree; j++) {
+        double v = Enter(next[j], e, b1, b2, w);
+        if (v > best) {
+            best = v;
+            choice = {ActionType::Move, next[j]};
+        }
+    }
+    if (armed) {
+        // not next to the enemy, so any tunnel misses
+        double v = Miss(p, e, b1, b2, w);
+        if (v > best) {
+            best = v;
+            choice = {ActionType::Attack, next[0]};
+        }
+    }
+    return best;
+}
+
+// f and F from the current values: the worth of being dropped in d while
+// the enemy is in e and the other bats in other, before the bats that
+// carried you settle anywhere in 1 .. n-1 but e, d and other. Only the
+// tables for weapon state w, the one being swept.
+void LayoutSolver::Drops(int w) {
+    for (int other = 1; other < n; other++) {
+        for (int e = 0; e < n; e++) {
+            size_t base = (size_t(w) * n + other) * n + e;
+            double total = 0;
+            for (int d = 1; d < n; d++) {
+                double f;
+                if (d == e) {
+                    f = rules.Fight(w);
+                } else if (pit[d] || d == other) {
+                    f = 0.0;        // d == other never counts, see Snatched
+                } else {
+                    int held = PickUp(d, w);
+                    double sum = 0;
+                    int count = 0;
+                    for (int b = 1; b < n; b++) {
+                        if (b == e || b == d || b == other)
+                            continue;
+                        sum += value[Key(d, e, b, other, held)];
+                        count++;
+                    }
+                    f = count ? sum / count : 0.0;
+                }
+                dropped[base * n + d] = f;
+                total += f;
+            }
+            droppedSum[base] = total;
+        }
+    }
+}
+
+LayoutResult LayoutSolver::Solve(const SolveLayout& layout, double epsilon) {
+    fill(value.begin(), value.end(), 0.0);
+    fill(pit.begin(), pit.end(), 0);
+    pit[layout.pit1] = pit[layout.pit2] = 1;
+    weaponRoom = layout.weaponRoom;
+    Action choice;
+
+    LayoutResult result;
+    result.iterations = 0;
+    // a weapon state only leads to itself and ones with less ammo, or from
+    // none to just picked up: solve the held states by rising ammo, then none
+    for (int block = 1; block <= rules.weaponStates; block++) {
+        int w = block % rules.weaponStates;
+        double change;
+        do {
+            Drops(w);
+            change = 0;
+            for (int b2 = 2; b2 < n; b2++) {
+                for (int b1 = 1; b1 < b2; b1++) {
+                    for (int e = 0; e < n; e++) {
+                        for (int p = 0; p < n; p++) {
+                            // the player is never left with the enemy, bats or a pit
+                            if (p == e || p == b1 || p == b2 || pit[p])
+                                continue;
+                            double best = Best(p, e, b1, b2, w, choice);
+                            double& v = value[Key(p, e, b1, b2, w)];
+                            change = max(change, best - v);
+                            v = best;
+                        }
+                    }
+                }
+            }
+            result.iterations++;
+        } while (change > epsilon);
+    }
+
+    // room 0 with every enemy and bat start the deck can deal around the layout
+    double sum = 0;
+    long starts = 0;
+    for (int e : rules.deck) {
+        if (pit[e] || e == weaponRoom)
+            continue;
+        for (int b1 : rules.deck) {
+            if (b1 == e || pit[b1] || b1 == weaponRoom)
+                continue;
+            for (int b2 : rules.deck) {
+                if (b2 == e || b2 == b1 || pit[b2] || b2 == weaponRoom)
+                    continue;
+                sum += value[Key(0, e, b1, b2, 0)];
+                starts++;
+            }
+        }
+    }
+    result.win = starts ? sum / starts : 0.0;
+    return result;
+}
+
+void LayoutSolver::WritePolicy(ostream& out) {
+    // the sweeps leave each weapon state's drop tables a sweep behind
+    for (int w = 0; w < rules.weaponStates; w++)
+        Drops(w);
+    Action choice;
+    for (int w = 0; w < rules.weaponStates; w++) {
+        for (int b2 = 2; b2 < n; b2++) {
+            for (int b1 = 1; b1 < b2; b1++) {
+                for (int e = 0; e < n; e++) {
+                    for (int p = 0; p < n; p++) {
+                        if (p == e || p == b1 || p == b2 || pit[p])
+                            continue;
+                        double win = Best(p, e, b1, b2, w, choice);
+                        const char* name = choice.type == ActionType::Move ? "move"
+                                         : choice.type == ActionType::Attack ? "attack" : "quit";
+                        out << p << ' ' << e << ' ' << b1 << ' ' << b2 << ' ' << w << "  "
+                            << name << ' ' << choice.room << "  " << win << '\n';
+                    }
+                }
+            }
+        }
+    }
+}
+
+// rooms at least distance tunnels from room 0, as the level's deck
+static vector<int> Deck(const Cave& cave, int distance) {
+    vector<int> depth(cave.NumRooms(), -1);
+    vector<int> queue(1, 0);
+    depth[0] = 0;
+    for (size_t i = 0; i < queue.size(); i++) {
+        int room = queue[i];
+        for (int j = 0; j < cave.Degree(room); j++) {
+            int next = cave.Neighbors(room)[j];
+            if (depth[next] < 0) {
+                depth[next] = depth[room] + 1;
+                queue.push_back(next);
+            }
+        }
+    }
+    vector<int> deck;
+    for (int room = 0; room < cave.NumRooms(); room++) {
+        if (depth[room] >= distance)
+            deck.push_back(room);
+    }
+    return deck;
+}
+
+int main(int argc, char* argv[]) {
+    int onlyLevel = -1;
+    CaveSpec caveSpec;
+    int minDistance = 1;
+    long numLayouts = 16;
+    bool all = false;
+    uint64_t seed = 1;
+    int threads = 0;
+    double epsilon = 1e-5;
+    const char* levelsPath = nullptr;
+    const char* policyPath = nullptr;
+    SolveLayout oneLayout = {-1, -1, -1};
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--level") == 0 && hasValue) {
+            onlyLevel = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--min-distance") == 0 && hasValue) {
+            minDistance = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--layouts") == 0 && hasValue) {
+            numLayouts = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--all") == 0) {
+            all = true;
+        } else if (strcmp(argv[i], "--layout") == 0 && hasValue) {
+            if (sscanf(argv[++i], "%d,%d,%d", &oneLayout.pit1, &oneLayout.pit2, &oneLayout.weaponRoom) != 3) {
+                cerr << "wump_solve: bad layout " << argv[i] << endl;
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--policy") == 0 && hasValue) {
+            policyPath = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--levels") == 0 && hasValue) {
+            levelsPath = argv[++i];
+        } else if (strcmp(argv[i], "--epsilon") == 0 && hasValue) {
+            epsilon = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--cave") == 0 && hasValue) {
+            if (!ParseCaveSpec(argv[++i], &caveSpec)) {
+                cerr << "wump_solve: bad cave " << argv[i] << endl;
+                return 2;
+            }
+        } else {
+            cerr << "usage: wump_solve [--level L] [--cave SPEC] [--min-distance D] "
+                 << "[--layouts K | --all | --layout P1,P2,W] [--seed S] [--threads T] "
+                 << "[--epsilon E] [--levels FILE] [--policy FILE]" << endl;
+            return 2;
+        }
+    }
+    if (threads < 1)
+        threads = int(thread::hardware_concurrency());
+    if (threads < 1)
+        threads = 1;
+
+    Cave cave = Cave::Dodecahedron();
+    LevelTable levels = LevelTable::Default();
+    try {
+        cave = Cave::Build(caveSpec);
+        if (levelsPath)
+            levels = LevelTable::Load(levelsPath);
+        for (int lev = 0; lev < levels.NumLevels(); lev++) {
+            if (onlyLevel >= 0 && lev != onlyLevel)
+                continue;
+            Level probe(lev, cave, levels);     // throws if the cave cannot hold it
+            probe.SetMinStartDistance(minDistance);
+        }
+    } catch (const exception& e) {
+        cerr << "wump_solve: " << e.what() << endl;
+        return 2;
+    }
+    if (onlyLevel >= levels.NumLevels()) {
+        cerr << "wump_solve: there are only " << levels.NumLevels() << " levels" << endl;
+        return 2;
+    }
+
+    // every (pit pair, weapon room) the deck can deal, each as likely
+    vector<int> deck = Deck(cave, minDistance);
+    vector<SolveLayout> layouts;
+    for (size_t a = 0; a < deck.size(); a++)
+        for (size_t b = a + 1; b < deck.size(); b++)
+            for (size_t w = 0; w < deck.size(); w++)
+                if (w != a && w != b)
+                    layouts.push_back({deck[a], deck[b], deck[w]});
+    if (oneLayout.weaponRoom >= 0 || policyPath) {
+        // a policy is a table per layout, so only for one of them
+        auto dealt = [&](int room) { return find(deck.begin(), deck.end(), room) != deck.end(); };
+        if (!dealt(oneLayout.pit1) || !dealt(oneLayout.pit2) || !dealt(oneLayout.weaponRoom)
+            || oneLayout.pit1 == oneLayout.pit2 || oneLayout.weaponRoom == oneLayout.pit1
+            || oneLayout.weaponRoom == oneLayout.pit2) {
+            cerr << "wump_solve: " << (policyPath ? "--policy needs " : "")
+                 << "--layout with three different rooms the level can deal" << endl;
+            return 2;
+        }
+        layouts.assign(1, oneLayout);
+        all = true;
+    } else if (!all && numLayouts < long(layouts.size())) {
+        Rng rng(seed);
+        for (long i = 0; i < numLayouts; i++)
+            swap(layouts[i], layouts[i + rng(int(layouts.size() - i))]);
+        layouts.resize(numLayouts);
+    }
+
+    ofstream policy;
+    if (policyPath)
+        policy.open(policyPath, ios::trunc);
+
+    cout << "cave            " << CaveSpecName(caveSpec) << " (" << cave.NumRooms() << " rooms)" << endl;
+    cout << "threads         " << threads << endl;
+    cout << "layouts         " << layouts.size() << (all ? " (all)" : " (sampled)") << endl;
+
+    for (int lev = 0; lev < levels.NumLevels(); lev++) {
+        if (onlyLevel >= 0 && lev != onlyLevel)
+            continue;
+        const LevelDef& def = levels.Def(lev);
+        if (def.numEnemies != 1 || def.numHazards != 2 || def.numRelocs != 2 || def.numWeapons != 1) {
+            cout << "level " << lev << "         skipped: only one enemy, two pits, two bats and one weapon"
+                 << " are solved" << endl;
+            continue;
+        }
+        const Enemy& enemy = levels.GetEnemy(lev);
+        const Weapon& weapon = levels.GetWeapon(lev);
+        SolveRules rules;
+        rules.cave = &cave;
+        rules.n = cave.NumRooms();
+        rules.pMove = enemy.pMove;
+        rules.moves = enemy.moves;
+        rules.pToHit = weapon.pToHit;
+        rules.isLimited = weapon.isLimited;
+        rules.pickedUp = 1 + (weapon.isLimited ? weapon.ammo : 0);
+        rules.weaponStates = rules.pickedUp + 1;
+        rules.deck = deck;
+        if (rules.NumStates() > MAX_STATES) {
+            cerr << "wump_solve: " << rules.NumStates() << " states is too many for level "
+                 << lev << endl;
+            return 1;
+        }
+
+        vector<LayoutResult> results(layouts.size());
+        atomic<size_t> nextLayout(0);
+        auto work = [&](bool writePolicy) {
+            LayoutSolver solver(rules);
+            for (size_t i = nextLayout++; i < layouts.size(); i = nextLayout++)
+                results[i] = solver.Solve(layouts[i], epsilon);
+            if (writePolicy) {
+                policy << "# level " << lev << ", pits " << layouts[0].pit1 << " " << layouts[0].pit2
+                       << ", weapon " << layouts[0].weaponRoom << "\n";
+                solver.WritePolicy(policy);
+            }
+        };
+        auto begin = chrono::steady_clock::now();
+        vector<thread> workers;
+        // the one layout of a policy is solved here, where it is written
+        for (int t = 1; t < threads && !policyPath; t++)
+            workers.emplace_back(work, false);
+        work(policyPath != nullptr);
+        for (thread& worker : workers)
+            worker.join();
+        if (policyPath && !policy) {
+            cerr << "wump_solve: cannot write " << policyPath << endl;
+            return 1;
+        }
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+        double sum = 0, sumSq = 0;
+        long iterations = 0;
+        for (const LayoutResult& r : results) {
+            sum += r.win;
+            sumSq += r.win * r.win;
+            iterations += r.iterations;
+        }
+        size_t k = results.size();
+        double mean = k ? sum / k : 0;
+        double var = k > 1 ? max(0.0, (sumSq - k * mean * mean) / (k - 1)) : 0;
+        // each sweep covers one weapon state's states, half of them for the bats' order
+        double swept = double(rules.NumStates()) / rules.weaponStates / 2 * iterations;
+
+        cout << "level " << lev << "         bound " << fixed << setprecision(4) << mean;
+        if (!all && k > 1)
+            cout << " +- " << 1.96 * sqrt(var / k);
+        cout << defaultfloat << setprecision(6) << "  (pMove " << rules.pMove << ", pToHit "
+             << rules.pToHit << ")  " << rules.NumStates() << " states, "
+             << (k ? double(iterations) / k : 0) << " sweeps/layout, " << secs << " s, "
+             << (secs > 0 ? swept / secs : 0) << " states/sec" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * wump_solver_bench - how fast the belief agent thinks
+ *
+ * usage: wump_solver_bench [--games N] [--seed S] [--cave SPEC]
+ *                          [--replays R] [--min-distance D]
+ *
+ * Plays seeded games with BeliefAgent, timing its BeginLevel() and Act()
+ * calls apart from the engine, and reports nanoseconds per decision next
+ * to games/sec and the win rate, so a change to the inference shows up
+ * as a change in both speed and strength.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include "wump_engine.h"
+#include "wump_agents.h"
+using namespace std;
+
+const int MAX_TURNS = 1000;
+
+int main(int argc, char* argv[]) {
+    long games = 20000;
+    uint64_t seed = 1;
+    int replays = 0;
+    int minDistance = 1;
+    CaveSpec caveSpec;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--games") == 0 && hasValue) {
+            games = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--replays") == 0 && hasValue) {
+            replays = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--min-distance") == 0 && hasValue) {
+            minDistance = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cave") == 0 && hasValue) {
+            if (!ParseCaveSpec(argv[++i], &caveSpec)) {
+                cerr << "wump_solver_bench: bad cave " << argv[i] << endl;
+                return 2;
+            }
+        } else {
+            cerr << "usage: wump_solver_bench [--games N] [--seed S] [--cave SPEC] "
+                 << "[--replays R] [--min-distance D]" << endl;
+            return 2;
+        }
+    }
+
+    Cave cave = Cave::Dodecahedron();
+    try {
+        cave = Cave::Build(caveSpec);
+        Level probe(0, cave);
+        probe.SetMinStartDistance(minDistance);
+    } catch (const exception& e) {
+        cerr << "wump_solver_bench: " << e.what() << endl;
+        return 2;
+    }
+
+    BeliefAgent agent(replays);
+    Game game(cave);
+    game.SetMinStartDistance(minDistance);
+    long won = 0, levels = 0, decisions = 0;
+    chrono::steady_clock::duration thinking{0};
+    auto begin = chrono::steady_clock::now();
+
+    for (long g = 0; g < games; g++) {
+        game.Reset();
+        game.Seed(seed + g);
+        uint64_t agentSeed = seed + g;
+        agent.Seed(Rng::Mix(agentSeed));
+        bool over = false, gameWon = false;
+        while (!over && !gameWon) {
+            Level& level = game.CurrentLevel();
+            StepResult step = level.Start();
+            auto t0 = chrono::steady_clock::now();
+            agent.BeginLevel(level, step);
+            thinking += chrono::steady_clock::now() - t0;
+            for (int turn = 0; step.state.phase != LevelPhase::Over; turn++) {
+                if (turn == MAX_TURNS) {
+                    step = level.Step({ActionType::Quit, -1});
+                    break;
+                }
+                t0 = chrono::steady_clock::now();
+                Action action = agent.Act(level, step);
+                thinking += chrono::steady_clock::now() - t0;
+                decisions++;
+                step = level.Step(action);
+            }
+            if (level.Result().killedEnemy)
+                levels++;
+            else
+                over = true;
+            gameWon = game.RecordResult(level.Result());
+        }
+        if (gameWon)
+            won++;
+    }
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    double thinkSecs = chrono::duration<double>(thinking).count();
+
+    cout << "cave            " << CaveSpecName(caveSpec) << " (" << cave.NumRooms() << " rooms)" << endl;
+    cout << "games           " << games << endl;
+    cout << "won             " << won << " (" << (games ? 100.0 * won / games : 0) << "%)" << endl;
+    cout << "levels cleared  " << levels << endl;
+    cout << "decisions       " << decisions << endl;
+    cout << "ns/decision     " << (decisions ? thinkSecs * 1e9 / decisions : 0) << endl;
+    cout << "agent share     " << (secs > 0 ? 100.0 * thinkSecs / secs : 0) << "%" << endl;
+    cout << "seconds         " << secs << endl;
+    cout << "games/sec       " << (secs > 0 ? games / secs : 0) << endl;
+    return 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * Wump.2 - sharing numbered tasks out by work stealing, see wump_steal.h
+ */
+
+#include "wump_steal.h"
+using namespace std;
+
+// conx
+StealingQueue::StealingQueue(long numTasks, int numWorkers) : ranges(numWorkers < 1 ? 1 : numWorkers) {
+    long workers = long(ranges.size());
+    for (long w = 0; w < workers; w++) {
+        ranges[w].next = numTasks * w / workers;
+        ranges[w].end  = numTasks * (w + 1) / workers;
+    }
+}
+
+bool StealingQueue::Next(int worker, long& task) {
+    Range& mine = ranges[worker];
+    for (;;) {
+        {
+            lock_guard<mutex> hold(mine.lock);
+            if (mine.next < mine.end) {
+                task = mine.next++;
+                return true;
+            }
+        }
+        if (!Steal(worker))
+            return false;
+    }
+}
+
+// Moves the back half of the busiest other range to worker's own; false
+// if there is nothing left anywhere. A range is only ever locked alone,
+// so thieves cannot deadlock each other.
+bool StealingQueue::Steal(int worker) {
+    for (;;) {
+        int victim = -1;
+        long most = 0;
+        for (int w = 0; w < int(ranges.size()); w++) {
+            if (w == worker)
+                continue;
+            lock_guard<mutex> hold(ranges[w].lock);
+            if (ranges[w].end - ranges[w].next > most) {
+                most = ranges[w].end - ranges[w].next;
+                victim = w;
+            }
+        }
+        if (victim < 0)
+            return false;
+
+        long from, to;
+        {
+            lock_guard<mutex> hold(ranges[victim].lock);
+            long left = ranges[victim].end - ranges[victim].next;
+            if (left <= 0)
+                continue;       // finished meanwhile: look again
+            to = ranges[victim].end;
+            from = to - (left + 1) / 2;
+            ranges[victim].end = from;
+        }
+        lock_guard<mutex> hold(ranges[worker].lock);
+        ranges[worker].next = from;
+        ranges[worker].end = to;
+        ranges[worker].steals++;
+        return true;
+    }
+}
+
+long StealingQueue::Steals() {
+    long steals = 0;
+    for (Range& range : ranges) {
+        lock_guard<mutex> hold(range.lock);
+        steals += range.steals;
+    }
+    return steals;
+}
@@ -0,0 +1,46 @@
+/*
+ * Wump.2 - sharing numbered tasks out to worker threads by work stealing
+ *
+ * Games vary from a handful of turns to thousands, so a fixed split
+ * (worker w plays w, w + T, w + 2T, ...) leaves workers idle behind the
+ * one that drew the long games. A StealingQueue starts each worker on an
+ * equal range of task numbers, which it takes from the front; a worker
+ * that runs out takes the back half of whatever the busiest other worker
+ * has left, so all of them finish within about one task of each other.
+ *
+ * Each range has its own lock, so a worker taking its own next task only
+ * ever contends with a thief, and thieves only come when a worker is
+ * done. Which worker runs a task changes from run to run; a task's number
+ * does not, so results kept by task number (or summed) do not depend on
+ * the scheduling.
+ */
+
+#ifndef WUMP_STEAL_H
+#define WUMP_STEAL_H
+
+#include <mutex>
+#include <vector>
+
+class StealingQueue {
+private:
+    struct Range {
+        std::mutex lock;
+        long next = 0, end = 0;     // tasks [next, end) still to run
+        long steals = 0;            // ranges this worker took from others
+    };
+    std::vector<Range> ranges;      // one per worker
+
+    bool Steal(int worker);
+
+public:
+    // tasks 0 to numTasks - 1 for workers 0 to numWorkers - 1
+    StealingQueue(long numTasks, int numWorkers);
+    StealingQueue(const StealingQueue&) = delete;
+    StealingQueue& operator=(const StealingQueue&) = delete;
+
+    // the next task for worker into task; false once every task is taken
+    bool Next(int worker, long& task);
+    long Steals();
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * Wump.2 - the game as lines of text, see wump_text.h
+ */
+
+#include "wump_text.h"
+#include <charconv>
+using namespace std;
+
+static const char* kBlanks = " \t\r\n";
+
+void SplitCommand(string_view line, string_view& word, string_view& arg) {
+    size_t start = line.find_first_not_of(kBlanks);
+    if (start == string_view::npos) {
+        word = arg = string_view();
+        return;
+    }
+    size_t end = line.find_first_of(kBlanks, start);
+    word = line.substr(start, end == string_view::npos ? string_view::npos : end - start);
+    size_t argStart = end == string_view::npos ? string_view::npos : line.find_first_not_of(kBlanks, end);
+    if (argStart == string_view::npos) {
+        arg = string_view();
+        return;
+    }
+    size_t argEnd = line.find_last_not_of(kBlanks);
+    arg = line.substr(argStart, argEnd + 1 - argStart);
+}
+
+// the room in arg, -1 unless it is all digits
+static int RoomNumber(string_view arg) {
+    int room = -1;
+    auto [end, error] = from_chars(arg.data(), arg.data() + arg.size(), room);
+    if (error != errc() || end != arg.data() + arg.size() || room < 0)
+        return -1;
+    return room;
+}
+
+bool ParseCommand(const Level& level, string_view word, string_view arg, Action& action) {
+    action = {ActionType::Quit, -1};
+    if (level.Phase() == LevelPhase::AwaitingReplay) {
+        if (word == "replay" || word == "r" || word == "0")
+            action.type = ActionType::Replay;
+        else if (word != "quit" && word != "q")
+            return false;
+    } else if ((word == "move" || word == "m") && !arg.empty()) {
+        action = {ActionType::Move, RoomNumber(arg)};
+    } else if (word == "attack" || word == "a") {
+        action = {ActionType::Attack, arg.empty() ? -1 : RoomNumber(arg)};
+    } else if (word != "quit" && word != "q") {
+        return false;
+    }
+    return true;
+}
+
+static void AddLine(string& out, const string& text) {
+    out += text;
+    out += '\n';
+}
+
+static void AddNumber(string& out, int value) {
+    char digits[16];
+    out.append(digits, to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+void DescribeEvents(const Level& level, const StepResult& step, string& out) {
+    for (int i = 0; i < step.numEvents; i++) {
+        const Event& event = step.events[i];
+        switch (event.type) {
+            case EventType::EnteredRoom:
+                out += "You are in room ";
+                AddNumber(out, event.room);
+                out += '\n';
+                if (event.value & WARN_ENEMY)
+                    AddLine(out, level.GetEnemy().warningMsg);
+                if (event.value & WARN_BATS)
+                    AddLine(out, level.GetReloc().nearMsg);
+                if (event.value & WARN_DRAFT)
+                    AddLine(out, level.GetHazard().nearMsg);
+                out += "Tunnels lead to rooms \n";
+                for (int j = 0; j < level.NumNeighbors(event.room); j++) {
+                    AddNumber(out, level.Neighbors(event.room)[j]);
+                    out += ' ';
+                }
+                out += '\n';
+                break;
+            case EventType::FoundWeapon:
+                AddLine(out, level.GetWeapon().foundMsg);
+                break;
+            case EventType::BatSnatched:
+                AddLine(out, level.GetReloc().snatchedMsg);
+                break;
+            case EventType::BatSaved:
+                AddLine(out, level.GetReloc().savedMsg);
+                break;
+            case EventType::BatDropped:
+                AddLine(out, level.GetReloc().snatchedMsg);
+                AddLine(out, level.GetReloc().movedMsg);
+                AddNumber(out, event.room);
+                out += '\n';
+                break;
+            case EventType::FellInPit:
+                AddLine(out, level.GetHazard().killedYouMsg);
+                break;
+            case EventType::KilledEnemy:
+                AddLine(out, level.GetEnemy().killedItMsg);
+                break;
+            case EventType::KilledByEnemy:
+                AddLine(out, level.GetEnemy().killedYouMsg);
+                break;
+            case EventType::LevelRestarted:
+                out += "Try not to die this time. \n";
+                break;
+            case EventType::InvalidMove:
+                out += "You cannot move there.\n";
+                break;
+            case EventType::InvalidAttack:
+                out += "You cannot attack there.\n";
+                break;
+            case EventType::CannotAttack:
+                out += "You cannot attack - no or limited weapon, or out of ammo.\n";
+                break;
+            case EventType::EnemyStartled:
+                out += "Miss! But you startled the ";
+                AddLine(out, level.GetEnemy().name);
+                break;
+            case EventType::EnemyMoved:
+                out += "And the enemy moved!\n";
+                break;
+            case EventType::AmmoLeft:
+                out += "Ammunition Left: ";
+                AddNumber(out, event.value);
+                out += '\n';
+                break;
+            case EventType::QuitLevel:
+                break;
+        }
+    }
+}
+
+const char* EventName(EventType type) {
+    switch (type) {
+        case EventType::EnteredRoom:    return "entered_room";
+        case EventType::FoundWeapon:    return "found_weapon";
+        case EventType::BatSnatched:    return "bat_snatched";
+        case EventType::BatSaved:       return "bat_saved";
+        case EventType::BatDropped:     return "bat_dropped";
+        case EventType::FellInPit:      return "fell_in_pit";
+        case EventType::KilledEnemy:    return "killed_enemy";
+        case EventType::KilledByEnemy:  return "killed_by_enemy";
+        case EventType::LevelRestarted: return "level_restarted";
+        case EventType::InvalidMove:    return "invalid_move";
+        case EventType::InvalidAttack:  return "invalid_attack";
+        case EventType::CannotAttack:   return "cannot_attack";
+        case EventType::EnemyStartled:  return "enemy_startled";
+        case EventType::EnemyMoved:     return "enemy_moved";
+        case EventType::AmmoLeft:       return "ammo_left";
+        case EventType::QuitLevel:      return "quit_level";
+    }
+    return "?";
+}
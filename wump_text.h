@@ -0,0 +1,31 @@
+/*
+ * Wump.2 - the game as lines of text
+ *
+ * Commands in, the console's words out, without the images: what
+ * wump_server speaks and what `Wump.2 --batch` plays. A command is one
+ * line, "move N", "attack N" and "quit" while playing, "replay" and
+ * "quit" after dying; "m", "a", "q" and "r" work too. Parsing looks at
+ * the line in place and never allocates.
+ */
+
+#ifndef WUMP_TEXT_H
+#define WUMP_TEXT_H
+
+#include <string>
+#include <string_view>
+#include "wump_engine.h"
+
+// Splits a command line into its first word and the rest, both trimmed
+void SplitCommand(std::string_view line, std::string_view& word, std::string_view& arg);
+
+// Reads one game command; false if it is not one. A room that is not a
+// number is -1, which the level turns down like any other bad room.
+bool ParseCommand(const Level&, std::string_view word, std::string_view arg, Action&);
+
+// The console's text for the events of one Start()/Step(), appended to out
+void DescribeEvents(const Level&, const StepResult&, std::string& out);
+
+// e.g. "entered_room", for output meant for programs
+const char* EventName(EventType);
+
+#endif